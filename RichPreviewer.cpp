@@ -22,6 +22,7 @@
 #include "CppTimer.h"
 #include "CppTimerManager.h"
 #include "CrashHandler.h"
+#include "EventLoop.h"
 #include "Interrupter.h"
 #include "JsAppImpl.h"
 #include "PreviewerEngineLog.h"
@@ -123,10 +124,14 @@ static void ProcessCommand()
     }
 
     VirtualScreenImpl::GetInstance().InitFrameCountTimer();
+    // Sleeps until a command arrives, a timer is due or the previewer is interrupted.
+    EventLoop eventLoop;
+    CommandLineInterface::GetInstance().WatchCommandSocket(eventLoop);
+    CppTimerManager& manager = CppTimerManager::GetTimerManager();
     while (!Interrupter::IsInterrupt()) {
         CommandLineInterface::GetInstance().ProcessCommand();
-        CppTimerManager::GetTimerManager().RunTimerTick();
-        this_thread::sleep_for(chrono::milliseconds(1));
+        manager.RunTimerTick();
+        eventLoop.Wait(manager.GetWaitTime());
     }
     JsAppImpl::GetInstance().Stop();
 }
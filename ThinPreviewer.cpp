@@ -24,6 +24,7 @@
 #include "CommandParser.h"
 #include "CppTimerManager.h"
 #include "CrashHandler.h"
+#include "EventLoop.h"
 #include "Interrupter.h"
 #include "JsAppImpl.h"
 #include "ModelManager.h"
@@ -186,10 +187,13 @@ int main(int argc, char* argv[])
     SharedData<uint8_t>::AppendNotify(SharedDataType::BRIGHTNESS_VALUE,
                                       TimerTaskHandler::CheckBrightnessValueChanged, curThreadId);
 
+    // Sleeps until a command arrives, a timer is due or the previewer is interrupted.
+    EventLoop eventLoop;
+    CommandLineInterface::GetInstance().WatchCommandSocket(eventLoop);
     while (!Interrupter::IsInterrupt()) {
         CommandLineInterface::GetInstance().ProcessCommand();
         manager.RunTimerTick();
-        this_thread::sleep_for(chrono::milliseconds(1));
+        eventLoop.Wait(manager.GetWaitTime());
     }
     JsAppImpl::GetInstance().Stop();
     this_thread::sleep_for(chrono::milliseconds(500));
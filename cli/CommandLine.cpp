@@ -31,6 +31,7 @@
 #include "MouseInputImpl.h"
 #include "MouseWheelImpl.h"
 #include "KeyInputImpl.h"
+#include "PerfStats.h"
 #include "PreviewerEngineLog.h"
 #include "SharedData.h"
 #include "VirtualMessageImpl.h"
@@ -66,10 +67,20 @@ void CommandLine::SendResult()
     if (commandResult.empty()) {
         return;
     }
+    if (resultCollector != nullptr) {
+        resultCollector->swap(commandResult);
+        commandResult.clear();
+        return;
+    }
     cliSocket << commandResult.toStyledString();
     commandResult.clear();
 }
 
+void CommandLine::SetResultCollector(Json::Value& result)
+{
+    resultCollector = &result;
+}
+
 void CommandLine::RunAndSendResultToManager()
 {
     Run();
@@ -1460,4 +1471,36 @@ void PointEventCommand::RunAction()
     param.name = "PointEvent";
     SetEventParams(param);
     SetCommandResult("result", true);
-}
\ No newline at end of file
+}
+
+PerfStatsCommand::PerfStatsCommand(CommandType commandType, const Json::Value& arg, const LocalSocket& socket)
+    : CommandLine(commandType, arg, socket)
+{
+}
+
+void PerfStatsCommand::RunGet()
+{
+    // Statistics since the previous PerfStats query, all durations in microseconds.
+    const double msPerSecond = 1000.0;
+    PerfStats::Summary summary = PerfStats::GetInstance().TakeSummary();
+    double seconds = std::max(summary.intervalMs, static_cast<int64_t>(1)) / msPerSecond;
+    Json::Value resultContent;
+    resultContent["intervalMs"] = static_cast<Json::Int64>(summary.intervalMs);
+    resultContent["frameCount"] = static_cast<Json::UInt64>(summary.frameCount);
+    resultContent["fps"] = summary.frameCount / seconds;
+    resultContent["bytesPerSecond"] = summary.byteCount / seconds;
+    Json::Value stages;
+    for (const PerfStats::StageSummary& stage : summary.stages) {
+        Json::Value stageValue;
+        stageValue["count"] = static_cast<Json::UInt64>(stage.count);
+        stageValue["mean"] = static_cast<Json::Int64>(stage.meanUs);
+        stageValue["p50"] = static_cast<Json::Int64>(stage.p50Us);
+        stageValue["p90"] = static_cast<Json::Int64>(stage.p90Us);
+        stageValue["p99"] = static_cast<Json::Int64>(stage.p99Us);
+        stageValue["max"] = static_cast<Json::Int64>(stage.maxUs);
+        stages[stage.name] = stageValue;
+    }
+    resultContent["stages"] = stages;
+    SetCommandResult("result", resultContent);
+    ILOG("Get PerfStats run finished.");
+}
@@ -34,6 +34,8 @@ public:
     void RunAndSendResultToManager();
     void SendResultToManager();
     void SendResult();
+    // Batched commands hand their result to the batch instead of sending it, the last result is kept.
+    void SetResultCollector(Json::Value& result);
     virtual void RunSet() {}
     bool IsArgValid() const;
     uint8_t ToUint8(std::string str) const;
@@ -86,6 +88,7 @@ protected:
 
 private:
     void Run();
+    Json::Value* resultCollector = nullptr;
 };
 
 class TouchAndMouseCommand {
@@ -492,4 +495,13 @@ protected:
     bool IsArgsExist() const;
     bool IsArgsValid() const;
 };
+
+class PerfStatsCommand : public CommandLine {
+public:
+    PerfStatsCommand(CommandType commandType, const Json::Value& arg, const LocalSocket& socket);
+    ~PerfStatsCommand() override {}
+
+protected:
+    void RunGet() override;
+};
 #endif // COMMANDLINE_H
@@ -71,14 +71,16 @@ void CommandLineFactory::InitCommandMap()
     typeMap["Resolution"] = &CommandLineFactory::CreateObject<ResolutionCommand>;
     typeMap["DeviceType"] = &CommandLineFactory::CreateObject<DeviceTypeCommand>;
     typeMap["PointEvent"] = &CommandLineFactory::CreateObject<PointEventCommand>;
+    typeMap["PerfStats"] = &CommandLineFactory::CreateObject<PerfStatsCommand>;
 }
 
-unique_ptr<CommandLine> CommandLineFactory::CreateCommandLine(string command,
+unique_ptr<CommandLine> CommandLineFactory::CreateCommandLine(const string& command,
                                                               CommandLine::CommandType type,
-                                                              Json::Value val,
+                                                              const Json::Value& val,
                                                               const LocalSocket& socket)
 {
-    if (typeMap.find(command) == typeMap.end()) {
+    auto creator = typeMap.find(command);
+    if (creator == typeMap.end()) {
         Json::Value commandResult;
         commandResult["version"] = CommandLineInterface::COMMAND_VERSION;
         commandResult["command"] = command;
@@ -88,11 +90,12 @@ unique_ptr<CommandLine> CommandLineFactory::CreateCommandLine(string command,
         TraceTool::GetInstance().HandleTrace("Mismatched SDK version");
         return nullptr;
     }
-    if (typeMap[command] == nullptr) {
+    if (creator->second == nullptr) {
         ELOG("CommandLineFactory::CreateCommandLine:typeMap is null");
+        return nullptr;
     }
     ILOG("Create Command: %s", command.c_str());
-    unique_ptr<CommandLine> cmdLine = typeMap[command](type, val, socket);
+    unique_ptr<CommandLine> cmdLine = creator->second(type, val, socket);
     if (cmdLine == nullptr) {
         ELOG("CommandLineFactory::CreateCommandLine:cmdLine is null");
     }
@@ -100,6 +103,11 @@ unique_ptr<CommandLine> CommandLineFactory::CreateCommandLine(string command,
     return cmdLine;
 }
 
+bool CommandLineFactory::IsCommandSupported(const string& command)
+{
+    return typeMap.find(command) != typeMap.end();
+}
+
 template <typename T>
 unique_ptr<CommandLine> CommandLineFactory::CreateObject(CommandLine::CommandType type,
                                                          const Json::Value& args, const LocalSocket& socket)
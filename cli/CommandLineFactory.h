@@ -25,10 +25,11 @@ public:
     CommandLineFactory();
     ~CommandLineFactory() {}
     static void InitCommandMap();
-    static std::unique_ptr<CommandLine> CreateCommandLine(std::string command,
+    static std::unique_ptr<CommandLine> CreateCommandLine(const std::string& command,
                                                           CommandLine::CommandType type,
-                                                          Json::Value args,
+                                                          const Json::Value& args,
                                                           const LocalSocket& socket);
+    static bool IsCommandSupported(const std::string& command);
 
 private:
     template <typename T>
@@ -16,29 +16,40 @@
 
 #include "CommandLineInterface.h"
 
+#include <algorithm>
 #include <chrono>
-#include <regex>
 
 #include "CommandLine.h"
 #include "CommandLineFactory.h"
 #include "JsonReader.h"
 #include "ModelManager.h"
 #include "PreviewerEngineLog.h"
+#include "PublicMethods.h"
 #include "VirtualScreen.h"
 #include "CommandParser.h"
+#include "Interrupter.h"
 
 using namespace std;
 
 const string CommandLineInterface::COMMAND_VERSION = "1.0.1";
+const string CommandLineInterface::BATCH_COMMAND = "Batch";
 bool CommandLineInterface::isFirstWsSend = true;
 bool CommandLineInterface::isPipeConnected = false;
-CommandLineInterface::CommandLineInterface() : socket(nullptr) {}
+CommandLineInterface::CommandLineInterface() : socket(nullptr), socketReader(nullptr), commandReader(nullptr)
+{
+    Json::CharReaderBuilder builder;
+    commandReader.reset(builder.newCharReader());
+    if (commandReader == nullptr) {
+        FLOG("CommandLineInterface: CharReader memory allocation failed.");
+    }
+}
 
 CommandLineInterface::~CommandLineInterface() {}
 
 void CommandLineInterface::InitPipe(const string name)
 {
     if (socket != nullptr) {
+        socketReader.reset();
         socket.reset();
         ELOG("CommandLineInterface::InitPipe socket is not null");
     }
@@ -51,6 +62,7 @@ void CommandLineInterface::InitPipe(const string name)
     if (!socket->ConnectToServer(socket->GetCommandPipeName(name), LocalSocket::READ_WRITE)) {
         FLOG("CommandLineInterface command pipe connect failed");
     }
+    socketReader = std::make_unique<LocalSocketReader>(*socket);
     isPipeConnected  = true;
 }
 
@@ -62,7 +74,7 @@ CommandLineInterface& CommandLineInterface::GetInstance()
 
 void CommandLineInterface::SendJsonData(const Json::Value& value)
 {
-    *(GetInstance().socket) << value.toStyledString();
+    GetInstance().socket->WriteMessage(value.toStyledString());
 }
 
 void CommandLineInterface::SendJSHeapMemory(size_t total, size_t alloc, size_t peak) const
@@ -79,7 +91,7 @@ void CommandLineInterface::SendJSHeapMemory(size_t total, size_t alloc, size_t p
         ELOG("CommandLineInterface::SendJSHeapMemory socket is null");
         return;
     }
-    *socket << result.toStyledString();
+    socket->WriteMessage(result.toStyledString());
 }
 
 void CommandLineInterface::SendWebsocketStartupSignal() const
@@ -94,8 +106,7 @@ void CommandLineInterface::SendWebsocketStartupSignal() const
 
 void CommandLineInterface::ProcessCommand() const
 {
-    string message; /* NOLINT */
-    if (socket == nullptr) {
+    if (socket == nullptr || socketReader == nullptr) {
         ELOG("CommandLineInterface::ProcessCommand socket is null");
         return;
     }
@@ -103,28 +114,29 @@ void CommandLineInterface::ProcessCommand() const
         isFirstWsSend = false;
         SendWebsocketStartupSignal();
     }
-    *socket >> message;
-    if (message.empty()) {
-        return;
+    // Several commands may have arrived since the last call, they are all handled in this pass.
+    std::vector<std::string> messages;
+    socketReader->ReadMessages(messages);
+    for (const auto& message : messages) {
+        ProcessCommandMessage(message);
     }
-
-    ProcessCommandMessage(message);
 }
 
-void CommandLineInterface::ProcessCommandMessage(std::string message) const
+void CommandLineInterface::WatchCommandSocket(EventLoop& eventLoop) const
 {
-    Json::CharReaderBuilder builder;
-    Json::CharReader* reader = builder.newCharReader();
-    if (reader == nullptr) {
-        FLOG("CommandLineInterface: CharReader memory allocation failed.");
+    if (socket != nullptr) {
+        eventLoop.WatchSocket(*socket);
     }
+}
 
+void CommandLineInterface::ProcessCommandMessage(const std::string& message) const
+{
     Json::Value jsonData;
     std::string errors; /* NOLINT */
 
-    bool parsingSuccessful = reader->parse(message.c_str(), message.c_str() + message.size(), &jsonData, &errors);
-    delete reader;
-    reader = nullptr;
+    // The reader is created once, building one per message cost more than parsing a MouseMove command.
+    bool parsingSuccessful =
+        commandReader->parse(message.c_str(), message.c_str() + message.size(), &jsonData, &errors);
 
     if (!ProcessCommandValidate(parsingSuccessful, jsonData, errors)) {
         return;
@@ -136,6 +148,10 @@ void CommandLineInterface::ProcessCommandMessage(std::string message) const
     }
 
     string command = jsonData["command"].asString();
+    if (command == BATCH_COMMAND) {
+        ProcessCommandBatch(jsonData["args"]);
+        return;
+    }
     if (CommandParser::GetInstance().IsStaticCard() && IsStaticIgnoreCmd(command)) {
         return;
     }
@@ -148,6 +164,65 @@ void CommandLineInterface::ProcessCommandMessage(std::string message) const
     commandLine->CheckAndRun();
 }
 
+void CommandLineInterface::ProcessCommandBatch(const Json::Value& args) const
+{
+    Json::Value batchResult;
+    batchResult["version"] = COMMAND_VERSION;
+    batchResult["command"] = BATCH_COMMAND;
+    if (!args.isObject() || !args.isMember("commands") || !args["commands"].isArray()) {
+        ELOG("Batch command error!");
+        batchResult["result"] = false;
+        socket->WriteMessage(batchResult.toStyledString());
+        return;
+    }
+    // The envelope was validated once, the commands run in order before the next command is read.
+    Json::Value results(Json::arrayValue);
+    for (const Json::Value& jsonData : args["commands"]) {
+        results.append(RunBatchedCommand(jsonData));
+        if (Interrupter::IsInterrupt()) {
+            ILOG("Batch command interrupted, %u commands run", results.size());
+            break;
+        }
+    }
+    batchResult["result"] = results;
+    socket->WriteMessage(batchResult.toStyledString());
+}
+
+Json::Value CommandLineInterface::RunBatchedCommand(const Json::Value& jsonData) const
+{
+    // Commands without a result, e.g. ignored ones, keep a null entry so results match commands by index.
+    Json::Value result;
+    if (!jsonData.isObject() || !jsonData["type"].isString() || !jsonData["command"].isString()) {
+        ELOG("Batched command error!");
+        result["result"] = false;
+        return result;
+    }
+    string command = jsonData["command"].asString();
+    CommandLine::CommandType type = GetCommandType(jsonData["type"].asString());
+    if (type == CommandLine::CommandType::INVALID || command == BATCH_COMMAND) {
+        result["command"] = command;
+        result["result"] = false;
+        return result;
+    }
+    if (CommandParser::GetInstance().IsStaticCard() && IsStaticIgnoreCmd(command)) {
+        return result;
+    }
+    if (!CommandLineFactory::IsCommandSupported(command)) {
+        ELOG("Unsupported batched command: %s", command.c_str());
+        result["command"] = command;
+        result["result"] = "Unsupported command";
+        return result;
+    }
+    std::unique_ptr<CommandLine> commandLine =
+        CommandLineFactory::CreateCommandLine(command, type, jsonData["args"], *socket);
+    if (commandLine == nullptr) {
+        return result;
+    }
+    commandLine->SetResultCollector(result);
+    commandLine->CheckAndRun();
+    return result;
+}
+
 bool CommandLineInterface::ProcessCommandValidate(bool parsingSuccessful,
                                                   const Json::Value& jsonData,
                                                   const std::string& errors) const
@@ -167,14 +242,14 @@ bool CommandLineInterface::ProcessCommandValidate(bool parsingSuccessful,
         return false;
     }
 
-    if (!regex_match(jsonData["version"].asString(), regex("(([0-9]|([1-9]([0-9]*))).){2}([0-9]|([1-9]([0-9]*)))"))) {
+    if (!PublicMethods::IsValidVersion(jsonData["version"].asString())) {
         ELOG("Invalid command version!");
         return false;
     }
     return true;
 }
 
-CommandLine::CommandType CommandLineInterface::GetCommandType(string name) const
+CommandLine::CommandType CommandLineInterface::GetCommandType(const string& name) const
 {
     CommandLine::CommandType type = CommandLine::CommandType::INVALID;
     if (name == "set") {
@@ -271,7 +346,7 @@ void CommandLineInterface::CreatCommandToSendData(const string commandName,
     commandLine->RunAndSendResultToManager();
 }
 
-bool CommandLineInterface::IsStaticIgnoreCmd(const string cmd) const
+bool CommandLineInterface::IsStaticIgnoreCmd(const string& cmd) const
 {
     auto it = std::find(staticIgnoreCmd.begin(), staticIgnoreCmd.end(), cmd);
     if (it != staticIgnoreCmd.end()) {
@@ -20,7 +20,9 @@
 #include <vector>
 
 #include "CommandLine.h"
+#include "EventLoop.h"
 #include "LocalSocket.h"
+#include "LocalSocketReader.h"
 #include "json.h"
 
 class CommandLineInterface {
@@ -33,7 +35,9 @@ public:
     void SendJSHeapMemory(size_t total, size_t alloc, size_t peak) const;
     void SendWebsocketStartupSignal() const;
     void ProcessCommand() const;
-    void ProcessCommandMessage(std::string message) const;
+    // Lets the event loop of the command thread wake up as soon as a command arrives.
+    void WatchCommandSocket(EventLoop& eventLoop) const;
+    void ProcessCommandMessage(const std::string& message) const;
     void ApplyConfig(const Json::Value& val) const;
     void ApplyConfigMembers(const Json::Value& commands, const Json::Value::Members& members) const;
     void ApplyConfigCommands(const std::string& key, const std::unique_ptr<CommandLine>& command) const;
@@ -42,18 +46,25 @@ public:
     void CreatCommandToSendData(const std::string, const Json::Value, const std::string) const;
 
     const static std::string COMMAND_VERSION;
+    // {"type": ..., "command": "Batch", "version": ..., "args": {"commands": [{"type", "command", "args"}, ...]}}
+    // runs the commands in order and answers with one result whose "result" holds their results in order.
+    const static std::string BATCH_COMMAND;
 
 private:
     explicit CommandLineInterface();
     virtual ~CommandLineInterface();
     bool ProcessCommandValidate(bool parsingSuccessful, const Json::Value& jsonData, const std::string& errors) const;
-    CommandLine::CommandType GetCommandType(std::string) const;
+    void ProcessCommandBatch(const Json::Value& args) const;
+    Json::Value RunBatchedCommand(const Json::Value& jsonData) const;
+    CommandLine::CommandType GetCommandType(const std::string& name) const;
     std::unique_ptr<LocalSocket> socket;
+    std::unique_ptr<LocalSocketReader> socketReader;
+    std::unique_ptr<Json::CharReader> commandReader; // reused for every command, only the command thread parses
     const static uint32_t MAX_COMMAND_LENGTH = 128;
     static bool isFirstWsSend;
     static bool isPipeConnected;
     std::vector<std::string> staticIgnoreCmd = { "ResolutionSwitch" };
-    bool IsStaticIgnoreCmd(const std::string cmd) const;
+    bool IsStaticIgnoreCmd(const std::string& cmd) const;
 };
 
 #endif // COMMANDLINEINTERFACE_H
@@ -149,6 +149,7 @@ void JsAppImpl::Interrupt()
     jsAbility.reset();
     isFinished = true;
     isInterrupt = true;
+    eventLoop.Wakeup();
     ILOG("JsAppImpl::ThreadCallBack finished");
 }
 
@@ -178,9 +179,11 @@ void JsAppImpl::ThreadCallBack()
 
     CppTimerManager& manager = CppTimerManager::GetTimerManager();
     while (!isInterrupt) {
-        this_thread::sleep_for(chrono::milliseconds(1));
+        eventLoop.Wait(manager.GetWaitTime());
         manager.RunTimerTick();
     }
+    // The js thread is detached, it releases the frames it sent before the singletons are destroyed.
+    VirtualScreenImpl::GetInstance().ReleaseFrames();
 }
 
 void JsAppImpl::InitTimer()
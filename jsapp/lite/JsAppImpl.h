@@ -20,6 +20,7 @@
 #include <thread>
 
 #include "CppTimer.h"
+#include "EventLoop.h"
 #include "JsApp.h"
 #include "js_ability.h"
 
@@ -46,6 +47,7 @@ private:
     std::unique_ptr<CppTimer> jsCheckTimer;
     std::unique_ptr<OHOS::ACELite::JSAbility> jsAbility;
     std::unique_ptr<std::thread> jsThread;
+    EventLoop eventLoop; // the js thread sleeps on it until the next timer is due
 
     void ThreadCallBack();
     void InitTimer();
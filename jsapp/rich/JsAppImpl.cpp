@@ -72,6 +72,7 @@ void JsAppImpl::Start()
         glfwRenderContext->PollEvents();
         std::this_thread::sleep_for(std::chrono::milliseconds(1));
     }
+    VirtualScreenImpl::GetInstance().Stop();
     isFinished = true;
 }
 
@@ -0,0 +1,91 @@
+/*
+ * Copyright (c) 2023 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "DirtyRegionDetector.h"
+
+#include <algorithm>
+
+namespace {
+constexpr int32_t PIXEL_SIZE = 4;
+}
+
+DirtyRegionDetector::DirtyRegionDetector() : frameWidth(0), frameHeight(0), isValid(false) {}
+
+void DirtyRegionDetector::Reset()
+{
+    isValid = false;
+}
+
+bool DirtyRegionDetector::Detect(const uint8_t* data, int32_t width, int32_t height, size_t stride,
+                                 Region& region)
+{
+    region = {0, 0, width, height};
+    if (data == nullptr || width < 1 || height < 1) {
+        return false;
+    }
+    int32_t tileColumns = (width + TILE_SIZE - 1) / TILE_SIZE;
+    int32_t tileRows = (height + TILE_SIZE - 1) / TILE_SIZE;
+    bool isFullFrame = !isValid || width != frameWidth || height != frameHeight;
+    if (isFullFrame) {
+        tileHashes.assign(static_cast<size_t>(tileColumns) * tileRows, 0);
+        tileStates.resize(tileColumns);
+        frameWidth = width;
+        frameHeight = height;
+        isValid = true;
+    }
+    int32_t minColumn = tileColumns;
+    int32_t minRow = tileRows;
+    int32_t maxColumn = -1;
+    int32_t maxRow = -1;
+    // The frame is read row by row, every row updates the hash states of all tiles in the current band.
+    for (int32_t tileRow = 0; tileRow < tileRows; tileRow++) {
+        for (FrameHash::State& state : tileStates) {
+            FrameHash::Init(state);
+        }
+        int32_t startRow = tileRow * TILE_SIZE;
+        int32_t endRow = std::min(startRow + TILE_SIZE, height);
+        for (int32_t row = startRow; row < endRow; row++) {
+            const uint8_t* line = data + static_cast<size_t>(row) * stride;
+            for (int32_t column = 0; column < tileColumns; column++) {
+                int32_t startColumn = column * TILE_SIZE;
+                int32_t pixels = std::min(TILE_SIZE, width - startColumn);
+                FrameHash::Update(tileStates[column], line + startColumn * PIXEL_SIZE, pixels * PIXEL_SIZE);
+            }
+        }
+        uint64_t* hashes = tileHashes.data() + static_cast<size_t>(tileRow) * tileColumns;
+        for (int32_t column = 0; column < tileColumns; column++) {
+            uint64_t hash = FrameHash::Finalize(tileStates[column]);
+            if (hash == hashes[column]) {
+                continue;
+            }
+            hashes[column] = hash;
+            minColumn = std::min(minColumn, column);
+            maxColumn = std::max(maxColumn, column);
+            minRow = std::min(minRow, tileRow);
+            maxRow = tileRow;
+        }
+    }
+    if (isFullFrame) {
+        return true;
+    }
+    if (maxColumn < 0) {
+        return false;
+    }
+    region.x = minColumn * TILE_SIZE;
+    region.y = minRow * TILE_SIZE;
+    region.width = std::min((maxColumn + 1) * TILE_SIZE, width) - region.x;
+    region.height = std::min((maxRow + 1) * TILE_SIZE, height) - region.y;
+    return true;
+}
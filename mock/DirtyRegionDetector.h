@@ -0,0 +1,54 @@
+/*
+ * Copyright (c) 2023 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef DIRTYREGIONDETECTOR_H
+#define DIRTYREGIONDETECTOR_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "FrameHash.h"
+
+// Finds the part of a 4 byte per pixel frame that changed since the previous frame. Every frame is split
+// into square tiles and only one hash per tile is kept, so no copy of the previous frame is needed.
+class DirtyRegionDetector {
+public:
+    struct Region {
+        int32_t x = 0;
+        int32_t y = 0;
+        int32_t width = 0;
+        int32_t height = 0;
+    };
+
+    DirtyRegionDetector();
+    ~DirtyRegionDetector() {}
+
+    // Returns false if no tile changed. On the first frame, after Reset or after a size change the whole
+    // frame is reported as changed.
+    bool Detect(const uint8_t* data, int32_t width, int32_t height, size_t stride, Region& region);
+    void Reset();
+
+private:
+    static constexpr int32_t TILE_SIZE = 32;
+
+    std::vector<uint64_t> tileHashes;
+    std::vector<FrameHash::State> tileStates;
+    int32_t frameWidth;
+    int32_t frameHeight;
+    bool isValid;
+};
+
+#endif // DIRTYREGIONDETECTOR_H
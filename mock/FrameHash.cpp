@@ -0,0 +1,95 @@
+/*
+ * Copyright (c) 2023 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "FrameHash.h"
+
+#include <cstring>
+
+namespace {
+constexpr uint64_t PRIME64_1 = 0x9E3779B185EBCA87ULL;
+constexpr uint64_t PRIME64_2 = 0xC2B2AE3D27D4EB4FULL;
+constexpr uint64_t PRIME64_3 = 0x165667B19E3779F9ULL;
+constexpr int ROUND_ROTATE = 31;
+constexpr int MERGE_ROTATE = 27;
+constexpr int AVALANCHE_SHIFT_1 = 33;
+constexpr int AVALANCHE_SHIFT_2 = 29;
+constexpr int AVALANCHE_SHIFT_3 = 32;
+constexpr int UINT64_BITS = 64;
+
+inline uint64_t RotateLeft(uint64_t value, int bits)
+{
+    return (value << bits) | (value >> (UINT64_BITS - bits));
+}
+
+inline uint64_t Round(uint64_t lane, uint64_t input)
+{
+    return RotateLeft(lane + input * PRIME64_2, ROUND_ROTATE) * PRIME64_1;
+}
+
+inline uint64_t ReadWord(const uint8_t* data)
+{
+    uint64_t word;
+    std::memcpy(&word, data, sizeof(word));
+    return word;
+}
+}
+
+void FrameHash::Init(State& state, uint64_t seed)
+{
+    for (size_t i = 0; i < LANE_COUNT; i++) {
+        state.lanes[i] = seed + PRIME64_3 * (i + 1);
+    }
+}
+
+void FrameHash::Update(State& state, const uint8_t* data, size_t length)
+{
+    const size_t stripeSize = LANE_COUNT * sizeof(uint64_t);
+    size_t pos = 0;
+    for (; pos + stripeSize <= length; pos += stripeSize) {
+        for (size_t i = 0; i < LANE_COUNT; i++) {
+            state.lanes[i] = Round(state.lanes[i], ReadWord(data + pos + i * sizeof(uint64_t)));
+        }
+    }
+    for (; pos + sizeof(uint64_t) <= length; pos += sizeof(uint64_t)) {
+        state.lanes[0] = Round(state.lanes[0], ReadWord(data + pos));
+    }
+    if (pos < length) {
+        uint64_t tail = 0;
+        std::memcpy(&tail, data + pos, length - pos);
+        state.lanes[1] = Round(state.lanes[1], tail ^ (length - pos));
+    }
+}
+
+uint64_t FrameHash::Finalize(const State& state)
+{
+    uint64_t hash = 0;
+    for (size_t i = 0; i < LANE_COUNT; i++) {
+        hash = RotateLeft(hash ^ Round(0, state.lanes[i]), MERGE_ROTATE) * PRIME64_1;
+    }
+    hash ^= hash >> AVALANCHE_SHIFT_1;
+    hash *= PRIME64_2;
+    hash ^= hash >> AVALANCHE_SHIFT_2;
+    hash *= PRIME64_3;
+    hash ^= hash >> AVALANCHE_SHIFT_3;
+    return hash;
+}
+
+uint64_t FrameHash::Compute(const uint8_t* data, size_t length, uint64_t seed)
+{
+    State state;
+    Init(state, seed ^ length);
+    Update(state, data, length);
+    return Finalize(state);
+}
@@ -0,0 +1,37 @@
+/*
+ * Copyright (c) 2023 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FRAMEHASH_H
+#define FRAMEHASH_H
+
+#include <cstddef>
+#include <cstdint>
+
+// Non-cryptographic 64 bit hash for frame contents, built like xxHash64: four independent lanes keep
+// several multiplies in flight. The state can be fed piecewise, for example one tile row at a time.
+class FrameHash {
+public:
+    static constexpr size_t LANE_COUNT = 4;
+    struct State {
+        uint64_t lanes[LANE_COUNT];
+    };
+
+    static void Init(State& state, uint64_t seed = 0);
+    static void Update(State& state, const uint8_t* data, size_t length);
+    static uint64_t Finalize(const State& state);
+    static uint64_t Compute(const uint8_t* data, size_t length, uint64_t seed = 0);
+};
+
+#endif // FRAMEHASH_H
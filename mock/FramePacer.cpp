@@ -0,0 +1,50 @@
+/*
+ * Copyright (c) 2023 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "FramePacer.h"
+
+FramePacer::FramePacer() : intervalMs(0)
+{
+}
+
+void FramePacer::SetIntervalMs(int32_t value)
+{
+    intervalMs = value > 0 ? value : 0;
+}
+
+int32_t FramePacer::GetIntervalMs() const
+{
+    return intervalMs;
+}
+
+std::chrono::milliseconds FramePacer::GetWaitTime() const
+{
+    auto now = std::chrono::steady_clock::now();
+    if (now >= nextTick) {
+        return std::chrono::milliseconds(0);
+    }
+    return std::chrono::duration_cast<std::chrono::milliseconds>(nextTick - now);
+}
+
+void FramePacer::OnFrameSent()
+{
+    auto now = std::chrono::steady_clock::now();
+    auto interval = std::chrono::milliseconds(intervalMs.load());
+    // Stay on the tick grid while frames keep coming, the first frame after an idle period starts a new one.
+    nextTick += interval;
+    if (nextTick <= now) {
+        nextTick = now + interval;
+    }
+}
@@ -0,0 +1,43 @@
+/*
+ * Copyright (c) 2023 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FRAMEPACER_H
+#define FRAMEPACER_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+// Sends frames on the ticks of a fixed rate clock. Frames that arrive between two ticks are coalesced
+// by the caller into the newest one, which goes out at the next tick, so the last frame of an animation
+// is delayed but never dropped.
+class FramePacer {
+public:
+    FramePacer();
+    ~FramePacer() {}
+
+    // Can be called from any thread, the new interval applies from the next tick on.
+    void SetIntervalMs(int32_t value);
+    int32_t GetIntervalMs() const;
+    // Time left until the next tick, zero if a frame may be sent now.
+    std::chrono::milliseconds GetWaitTime() const;
+    void OnFrameSent();
+
+private:
+    std::atomic<int32_t> intervalMs;
+    std::chrono::steady_clock::time_point nextTick; // only used by the sending thread
+};
+
+#endif // FRAMEPACER_H
@@ -0,0 +1,372 @@
+/*
+ * Copyright (c) 2023 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "FrameScaler.h"
+
+#include <algorithm>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define FRAME_SCALER_X86
+#include <immintrin.h>
+#elif defined(__aarch64__) || defined(__ARM_NEON)
+#define FRAME_SCALER_NEON
+#include <arm_neon.h>
+#endif
+
+#include "PreviewerEngineLog.h"
+
+namespace {
+constexpr size_t PIXEL_SIZE = 4;
+constexpr int WEIGHT_BITS = 7; // bilinear weights are 1/128 units, so a weighted byte fits in 16 bits
+constexpr uint32_t WEIGHT_ONE = 1 << WEIGHT_BITS;
+constexpr uint32_t WEIGHT_ROUND = WEIGHT_ONE >> 1;
+
+inline uint8_t Average(uint32_t first, uint32_t second)
+{
+    return static_cast<uint8_t>((first + second + 1) >> 1);
+}
+
+inline uint8_t Blend(uint32_t first, uint32_t second, uint32_t weight)
+{
+    return static_cast<uint8_t>((first * (WEIGHT_ONE - weight) + second * weight + WEIGHT_ROUND) >> WEIGHT_BITS);
+}
+
+// The rows are averaged first and the two columns after, the same rounding the SIMD versions use.
+void HalveRowScalar(const uint8_t* row0, const uint8_t* row1, uint8_t* dst, size_t dstPixels)
+{
+    for (size_t i = 0; i < dstPixels; ++i) {
+        for (size_t c = 0; c < PIXEL_SIZE; ++c) {
+            uint8_t left = Average(row0[c], row1[c]);
+            uint8_t right = Average(row0[PIXEL_SIZE + c], row1[PIXEL_SIZE + c]);
+            dst[c] = Average(left, right);
+        }
+        row0 += PIXEL_SIZE * 2; // 2 source pixels per destination pixel
+        row1 += PIXEL_SIZE * 2;
+        dst += PIXEL_SIZE;
+    }
+}
+
+void BlendRowScalar(const uint8_t* row0, const uint8_t* row1, uint8_t* dst, size_t size, uint32_t weight)
+{
+    for (size_t i = 0; i < size; ++i) {
+        dst[i] = Blend(row0[i], row1[i], weight);
+    }
+}
+
+// The caller makes sure every index has a right neighbour, a weight of 0 keeps the left pixel.
+void ScaleRowScalar(const uint8_t* row, const int32_t* indexes, const uint32_t* weights, uint8_t* dst,
+                    size_t dstPixels)
+{
+    for (size_t i = 0; i < dstPixels; ++i) {
+        const uint8_t* left = row + static_cast<size_t>(indexes[i]) * PIXEL_SIZE;
+        for (size_t c = 0; c < PIXEL_SIZE; ++c) {
+            dst[c] = Blend(left[c], left[PIXEL_SIZE + c], weights[i]);
+        }
+        dst += PIXEL_SIZE;
+    }
+}
+
+#ifdef FRAME_SCALER_X86
+constexpr size_t SSE_STEP_PIXELS = 4;  // destination pixels per 16 byte store
+constexpr size_t SSE_STEP_BYTES = 16;
+constexpr size_t AVX_STEP_BYTES = 32;
+constexpr int HALF_BYTES = 8;
+
+// Two 16 byte loads hold 8 source pixels, the even and odd pixels are split with a float shuffle.
+__attribute__((target("sse2"))) void HalveRowSse2(const uint8_t* row0, const uint8_t* row1, uint8_t* dst,
+                                                  size_t dstPixels)
+{
+    size_t i = 0;
+    for (; i + SSE_STEP_PIXELS <= dstPixels; i += SSE_STEP_PIXELS) {
+        const __m128i* in0 = reinterpret_cast<const __m128i*>(row0 + i * PIXEL_SIZE * 2);
+        const __m128i* in1 = reinterpret_cast<const __m128i*>(row1 + i * PIXEL_SIZE * 2);
+        __m128 first = _mm_castsi128_ps(_mm_avg_epu8(_mm_loadu_si128(in0), _mm_loadu_si128(in1)));
+        __m128 second = _mm_castsi128_ps(_mm_avg_epu8(_mm_loadu_si128(in0 + 1), _mm_loadu_si128(in1 + 1)));
+        __m128i even = _mm_castps_si128(_mm_shuffle_ps(first, second, _MM_SHUFFLE(2, 0, 2, 0)));
+        __m128i odd = _mm_castps_si128(_mm_shuffle_ps(first, second, _MM_SHUFFLE(3, 1, 3, 1)));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * PIXEL_SIZE), _mm_avg_epu8(even, odd));
+    }
+    HalveRowScalar(row0 + i * PIXEL_SIZE * 2, row1 + i * PIXEL_SIZE * 2, dst + i * PIXEL_SIZE, dstPixels - i);
+}
+
+__attribute__((target("sse2"))) __m128i Blend128(__m128i first, __m128i second, __m128i weight0, __m128i weight1)
+{
+    const __m128i round = _mm_set1_epi16(static_cast<int16_t>(WEIGHT_ROUND));
+    __m128i sum = _mm_add_epi16(_mm_mullo_epi16(first, weight0), _mm_mullo_epi16(second, weight1));
+    return _mm_srli_epi16(_mm_add_epi16(sum, round), WEIGHT_BITS);
+}
+
+__attribute__((target("sse2"))) void BlendRowSse2(const uint8_t* row0, const uint8_t* row1, uint8_t* dst,
+                                                  size_t size, uint32_t weight)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i weight0 = _mm_set1_epi16(static_cast<int16_t>(WEIGHT_ONE - weight));
+    const __m128i weight1 = _mm_set1_epi16(static_cast<int16_t>(weight));
+    size_t i = 0;
+    for (; i + SSE_STEP_BYTES <= size; i += SSE_STEP_BYTES) {
+        __m128i first = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row0 + i));
+        __m128i second = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row1 + i));
+        __m128i low = Blend128(_mm_unpacklo_epi8(first, zero), _mm_unpacklo_epi8(second, zero), weight0, weight1);
+        __m128i high = Blend128(_mm_unpackhi_epi8(first, zero), _mm_unpackhi_epi8(second, zero), weight0, weight1);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_packus_epi16(low, high));
+    }
+    BlendRowScalar(row0 + i, row1 + i, dst + i, size - i, weight);
+}
+
+// Weighs the left and right pixel of an 8 byte load, the 4 channel sums end up in the low half.
+__attribute__((target("sse2"))) __m128i BlendPair(const uint8_t* left, uint32_t weight)
+{
+    const __m128i zero = _mm_setzero_si128();
+    __m128i pixels = _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(left)), zero);
+    int16_t weight0 = static_cast<int16_t>(WEIGHT_ONE - weight);
+    int16_t weight1 = static_cast<int16_t>(weight);
+    __m128i weighted = _mm_mullo_epi16(pixels, _mm_set_epi16(weight1, weight1, weight1, weight1,
+                                                             weight0, weight0, weight0, weight0));
+    return _mm_add_epi16(weighted, _mm_srli_si128(weighted, HALF_BYTES));
+}
+
+__attribute__((target("sse2"))) void ScaleRowSse2(const uint8_t* row, const int32_t* indexes,
+                                                  const uint32_t* weights, uint8_t* dst, size_t dstPixels)
+{
+    const __m128i round = _mm_set1_epi16(static_cast<int16_t>(WEIGHT_ROUND));
+    size_t i = 0;
+    for (; i + 2 <= dstPixels; i += 2) { // 2 pixels fill the low 8 bytes of a store
+        __m128i first = BlendPair(row + static_cast<size_t>(indexes[i]) * PIXEL_SIZE, weights[i]);
+        __m128i second = BlendPair(row + static_cast<size_t>(indexes[i + 1]) * PIXEL_SIZE, weights[i + 1]);
+        __m128i result = _mm_srli_epi16(_mm_add_epi16(_mm_unpacklo_epi64(first, second), round), WEIGHT_BITS);
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(dst + i * PIXEL_SIZE), _mm_packus_epi16(result, result));
+    }
+    ScaleRowScalar(row, indexes + i, weights + i, dst + i * PIXEL_SIZE, dstPixels - i);
+}
+
+// Unpack and pack both work per 128 bit lane, so the byte order is kept without a permute.
+__attribute__((target("avx2"))) __m256i Blend256(__m256i first, __m256i second, __m256i weight0, __m256i weight1)
+{
+    const __m256i round = _mm256_set1_epi16(static_cast<int16_t>(WEIGHT_ROUND));
+    __m256i sum = _mm256_add_epi16(_mm256_mullo_epi16(first, weight0), _mm256_mullo_epi16(second, weight1));
+    return _mm256_srli_epi16(_mm256_add_epi16(sum, round), WEIGHT_BITS);
+}
+
+__attribute__((target("avx2"))) void BlendRowAvx2(const uint8_t* row0, const uint8_t* row1, uint8_t* dst,
+                                                  size_t size, uint32_t weight)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i weight0 = _mm256_set1_epi16(static_cast<int16_t>(WEIGHT_ONE - weight));
+    const __m256i weight1 = _mm256_set1_epi16(static_cast<int16_t>(weight));
+    size_t i = 0;
+    for (; i + AVX_STEP_BYTES <= size; i += AVX_STEP_BYTES) {
+        __m256i first = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row0 + i));
+        __m256i second = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row1 + i));
+        __m256i low = Blend256(_mm256_unpacklo_epi8(first, zero), _mm256_unpacklo_epi8(second, zero),
+                               weight0, weight1);
+        __m256i high = Blend256(_mm256_unpackhi_epi8(first, zero), _mm256_unpackhi_epi8(second, zero),
+                                weight0, weight1);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_packus_epi16(low, high));
+    }
+    BlendRowSse2(row0 + i, row1 + i, dst + i, size - i, weight);
+}
+#endif // FRAME_SCALER_X86
+
+#ifdef FRAME_SCALER_NEON
+constexpr size_t NEON_STEP_PIXELS = 4;
+constexpr size_t NEON_STEP_BYTES = 16;
+
+void HalveRowNeon(const uint8_t* row0, const uint8_t* row1, uint8_t* dst, size_t dstPixels)
+{
+    size_t i = 0;
+    for (; i + NEON_STEP_PIXELS <= dstPixels; i += NEON_STEP_PIXELS) {
+        const uint8_t* in0 = row0 + i * PIXEL_SIZE * 2;
+        const uint8_t* in1 = row1 + i * PIXEL_SIZE * 2;
+        uint8x16_t first = vrhaddq_u8(vld1q_u8(in0), vld1q_u8(in1));
+        uint8x16_t second = vrhaddq_u8(vld1q_u8(in0 + NEON_STEP_BYTES), vld1q_u8(in1 + NEON_STEP_BYTES));
+        uint32x4x2_t pixels = vuzpq_u32(vreinterpretq_u32_u8(first), vreinterpretq_u32_u8(second));
+        vst1q_u8(dst + i * PIXEL_SIZE,
+                 vrhaddq_u8(vreinterpretq_u8_u32(pixels.val[0]), vreinterpretq_u8_u32(pixels.val[1])));
+    }
+    HalveRowScalar(row0 + i * PIXEL_SIZE * 2, row1 + i * PIXEL_SIZE * 2, dst + i * PIXEL_SIZE, dstPixels - i);
+}
+
+void BlendRowNeon(const uint8_t* row0, const uint8_t* row1, uint8_t* dst, size_t size, uint32_t weight)
+{
+    const uint8x8_t weight0 = vdup_n_u8(static_cast<uint8_t>(WEIGHT_ONE - weight));
+    const uint8x8_t weight1 = vdup_n_u8(static_cast<uint8_t>(weight));
+    size_t i = 0;
+    for (; i + NEON_STEP_BYTES <= size; i += NEON_STEP_BYTES) {
+        uint8x16_t first = vld1q_u8(row0 + i);
+        uint8x16_t second = vld1q_u8(row1 + i);
+        uint16x8_t low = vmlal_u8(vmull_u8(vget_low_u8(first), weight0), vget_low_u8(second), weight1);
+        uint16x8_t high = vmlal_u8(vmull_u8(vget_high_u8(first), weight0), vget_high_u8(second), weight1);
+        vst1q_u8(dst + i, vcombine_u8(vrshrn_n_u16(low, WEIGHT_BITS), vrshrn_n_u16(high, WEIGHT_BITS)));
+    }
+    BlendRowScalar(row0 + i, row1 + i, dst + i, size - i, weight);
+}
+
+// Weighs the left and right pixel of an 8 byte load and adds the halves, 4 channel sums are left.
+inline uint16x4_t BlendPairNeon(const uint8_t* left, uint32_t weight)
+{
+    uint8x8_t weights = vcombine_u8(vdup_n_u8(static_cast<uint8_t>(WEIGHT_ONE - weight)),
+                                    vdup_n_u8(static_cast<uint8_t>(weight)));
+    uint16x8_t weighted = vmull_u8(vld1_u8(left), weights);
+    return vadd_u16(vget_low_u16(weighted), vget_high_u16(weighted));
+}
+
+void ScaleRowNeon(const uint8_t* row, const int32_t* indexes, const uint32_t* weights, uint8_t* dst,
+                  size_t dstPixels)
+{
+    size_t i = 0;
+    for (; i + 2 <= dstPixels; i += 2) { // 2 pixels fill an 8 byte store
+        uint16x4_t first = BlendPairNeon(row + static_cast<size_t>(indexes[i]) * PIXEL_SIZE, weights[i]);
+        uint16x4_t second = BlendPairNeon(row + static_cast<size_t>(indexes[i + 1]) * PIXEL_SIZE, weights[i + 1]);
+        vst1_u8(dst + i * PIXEL_SIZE, vrshrn_n_u16(vcombine_u16(first, second), WEIGHT_BITS));
+    }
+    ScaleRowScalar(row, indexes + i, weights + i, dst + i * PIXEL_SIZE, dstPixels - i);
+}
+#endif // FRAME_SCALER_NEON
+}
+
+const uint8_t* FrameScaler::Scale(const uint8_t* data, int32_t width, int32_t height, size_t stride,
+                                  int32_t dstWidth, int32_t dstHeight)
+{
+    if (data == nullptr || width < 1 || height < 1 || dstWidth < 1 || dstHeight < 1 ||
+        stride < static_cast<size_t>(width) * PIXEL_SIZE) {
+        ELOG("FrameScaler::Scale invalid frame %d x %d to %d x %d", width, height, dstWidth, dstHeight);
+        return nullptr;
+    }
+    const uint8_t* current = data;
+    halfBufferIndex = 0;
+    while (width >= dstWidth * 2 && height >= dstHeight * 2) {
+        current = Halve(current, width, height, stride);
+    }
+    if (width == dstWidth && height == dstHeight && stride == static_cast<size_t>(width) * PIXEL_SIZE) {
+        return current;
+    }
+    Bilinear(current, width, height, stride, dstWidth, dstHeight);
+    return outputBuffer.data();
+}
+
+const uint8_t* FrameScaler::Halve(const uint8_t* data, int32_t& width, int32_t& height, size_t& stride)
+{
+    int32_t dstWidth = width / 2;
+    int32_t dstHeight = height / 2;
+    size_t dstStride = static_cast<size_t>(dstWidth) * PIXEL_SIZE;
+    std::vector<uint8_t>& buffer = halfBuffers[halfBufferIndex];
+    halfBufferIndex ^= 1;
+    buffer.resize(dstStride * dstHeight);
+    const KernelTable& table = GetTable();
+    for (int32_t y = 0; y < dstHeight; ++y) {
+        const uint8_t* row0 = data + static_cast<size_t>(y) * 2 * stride;
+        table.halveRow(row0, row0 + stride, buffer.data() + y * dstStride, dstWidth);
+    }
+    width = dstWidth;
+    height = dstHeight;
+    stride = dstStride;
+    return buffer.data();
+}
+
+void FrameScaler::Bilinear(const uint8_t* data, int32_t width, int32_t height, size_t stride,
+                           int32_t dstWidth, int32_t dstHeight)
+{
+    InitAxis(width, dstWidth, xIndexes, xWeights);
+    InitAxis(height, dstHeight, yIndexes, yWeights);
+    // Only the pixels clamped to the last column have no right neighbour, they are copied as they are.
+    size_t pairCount = static_cast<size_t>(dstWidth);
+    while (pairCount > 0 && xIndexes[pairCount - 1] >= width - 1) {
+        pairCount--;
+    }
+    size_t rowSize = static_cast<size_t>(width) * PIXEL_SIZE;
+    size_t dstStride = static_cast<size_t>(dstWidth) * PIXEL_SIZE;
+    rowBuffer.resize(rowSize);
+    outputBuffer.resize(dstStride * dstHeight);
+    const KernelTable& table = GetTable();
+    for (int32_t dy = 0; dy < dstHeight; ++dy) {
+        const uint8_t* row = data + static_cast<size_t>(yIndexes[dy]) * stride;
+        if (yWeights[dy] != 0) {
+            table.blendRow(row, row + stride, rowBuffer.data(), rowSize, yWeights[dy]);
+            row = rowBuffer.data();
+        }
+        uint8_t* dst = outputBuffer.data() + dy * dstStride;
+        if (width == dstWidth) {
+            std::copy(row, row + rowSize, dst);
+            continue;
+        }
+        table.scaleRow(row, xIndexes.data(), xWeights.data(), dst, pairCount);
+        for (size_t dx = pairCount; dx < static_cast<size_t>(dstWidth); ++dx) {
+            std::copy(row + rowSize - PIXEL_SIZE, row + rowSize, dst + dx * PIXEL_SIZE);
+        }
+    }
+}
+
+// Pixel centers are aligned, the source position of a destination pixel is (d + 0.5) * src / dst - 0.5.
+// A weight of 0 means the pixel at the index is used alone, so the last pixel is never read past.
+void FrameScaler::InitAxis(int32_t srcSize, int32_t dstSize, std::vector<int32_t>& indexes,
+                           std::vector<uint32_t>& weights)
+{
+    indexes.resize(dstSize);
+    weights.resize(dstSize);
+    for (int32_t d = 0; d < dstSize; ++d) {
+        int64_t numerator = (2 * static_cast<int64_t>(d) + 1) * srcSize - dstSize;
+        int64_t position = numerator <= 0 ? 0 : (numerator << WEIGHT_BITS) / (2 * static_cast<int64_t>(dstSize));
+        int32_t index = static_cast<int32_t>(position >> WEIGHT_BITS);
+        uint32_t weight = static_cast<uint32_t>(position) & (WEIGHT_ONE - 1);
+        if (index >= srcSize - 1) {
+            index = srcSize - 1;
+            weight = 0;
+        }
+        indexes[d] = index;
+        weights[d] = weight;
+    }
+}
+
+FrameScaler::Variant FrameScaler::GetVariant()
+{
+    return GetTable().variant;
+}
+
+const char* FrameScaler::GetVariantName(Variant variant)
+{
+    switch (variant) {
+        case Variant::SSE2:
+            return "sse2";
+        case Variant::AVX2:
+            return "avx2";
+        case Variant::NEON:
+            return "neon";
+        default:
+            return "scalar";
+    }
+}
+
+const FrameScaler::KernelTable& FrameScaler::GetTable()
+{
+    static const KernelTable table = SelectTable();
+    return table;
+}
+
+FrameScaler::KernelTable FrameScaler::SelectTable()
+{
+    KernelTable table = {Variant::SCALAR, HalveRowScalar, BlendRowScalar, ScaleRowScalar};
+#if defined(FRAME_SCALER_X86)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        table = {Variant::AVX2, HalveRowSse2, BlendRowAvx2, ScaleRowSse2};
+    } else if (__builtin_cpu_supports("sse2")) {
+        table = {Variant::SSE2, HalveRowSse2, BlendRowSse2, ScaleRowSse2};
+    }
+#elif defined(FRAME_SCALER_NEON)
+    table = {Variant::NEON, HalveRowNeon, BlendRowNeon, ScaleRowNeon};
+#endif
+    ILOG("FrameScaler use %s implementation", GetVariantName(table.variant));
+    return table;
+}
@@ -0,0 +1,74 @@
+/*
+ * Copyright (c) 2023 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FRAMESCALER_H
+#define FRAMESCALER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Downscales 4 bytes per pixel frames, the byte order of the pixels is kept so RGBA and BGRA both work.
+// The frame is halved with a 2x2 box filter while it is at least twice the target size, the rest is
+// done with a bilinear filter. The row kernels use the fastest implementation supported by the cpu.
+class FrameScaler {
+public:
+    enum class Variant { SCALAR = 0, SSE2, AVX2, NEON };
+
+    FrameScaler() = default;
+    FrameScaler(const FrameScaler&) = delete;
+    FrameScaler& operator=(const FrameScaler&) = delete;
+
+    // Returns the scaled frame with a stride of dstWidth * 4, valid until the next call.
+    // nullptr is returned for invalid arguments.
+    const uint8_t* Scale(const uint8_t* data, int32_t width, int32_t height, size_t stride,
+                         int32_t dstWidth, int32_t dstHeight);
+
+    static Variant GetVariant();
+    static const char* GetVariantName(Variant variant);
+
+private:
+    // Averages 2x2 blocks of two source rows into dstPixels pixels.
+    using HalveFunc = void (*)(const uint8_t*, const uint8_t*, uint8_t*, size_t);
+    // Blends two rows byte by byte, weight is the share of the second row in 1/128 units.
+    using BlendFunc = void (*)(const uint8_t*, const uint8_t*, uint8_t*, size_t, uint32_t);
+    // Blends the pixel at every index with its right neighbour into one destination pixel.
+    using ScaleFunc = void (*)(const uint8_t*, const int32_t*, const uint32_t*, uint8_t*, size_t);
+    struct KernelTable {
+        Variant variant;
+        HalveFunc halveRow;
+        BlendFunc blendRow;
+        ScaleFunc scaleRow;
+    };
+    static const KernelTable& GetTable();
+    static KernelTable SelectTable();
+
+    const uint8_t* Halve(const uint8_t* data, int32_t& width, int32_t& height, size_t& stride);
+    void Bilinear(const uint8_t* data, int32_t width, int32_t height, size_t stride,
+                  int32_t dstWidth, int32_t dstHeight);
+    static void InitAxis(int32_t srcSize, int32_t dstSize, std::vector<int32_t>& indexes,
+                         std::vector<uint32_t>& weights);
+
+    std::vector<uint8_t> halfBuffers[2];
+    size_t halfBufferIndex = 0;
+    std::vector<uint8_t> rowBuffer;
+    std::vector<uint8_t> outputBuffer;
+    std::vector<int32_t> xIndexes;
+    std::vector<uint32_t> xWeights;
+    std::vector<int32_t> yIndexes;
+    std::vector<uint32_t> yWeights;
+};
+
+#endif // FRAMESCALER_H
@@ -0,0 +1,175 @@
+/*
+ * Copyright (c) 2023 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "JpegEncoder.h"
+
+#include <cstdio>
+
+#define boolean jpegboolean
+#include "jpeglib.h"
+#undef boolean
+
+#include "PixelConverter.h"
+#include "PreviewerEngineLog.h"
+
+struct JpegEncoder::Context {
+    jpeg_compress_struct jpeg;
+    jpeg_error_mgr jerr;
+    jpeg_destination_mgr dest;
+    std::vector<uint8_t>* buffer;
+    size_t* size;
+
+    static void InitDestination(j_compress_ptr cinfo)
+    {
+        Context* ctx = static_cast<Context*>(cinfo->client_data);
+        ctx->dest.next_output_byte = ctx->buffer->data();
+        ctx->dest.free_in_buffer = ctx->buffer->size();
+    }
+
+    // Called when the output buffer is full, the buffer is doubled and kept for the next frames.
+    static jpegboolean EmptyOutputBuffer(j_compress_ptr cinfo)
+    {
+        Context* ctx = static_cast<Context*>(cinfo->client_data);
+        size_t usedSize = ctx->buffer->size();
+        ctx->buffer->resize(usedSize * 2); // 2: double the output buffer
+        ctx->dest.next_output_byte = ctx->buffer->data() + usedSize;
+        ctx->dest.free_in_buffer = ctx->buffer->size() - usedSize;
+        return TRUE;
+    }
+
+    static void TermDestination(j_compress_ptr cinfo)
+    {
+        Context* ctx = static_cast<Context*>(cinfo->client_data);
+        *(ctx->size) = ctx->buffer->size() - ctx->dest.free_in_buffer;
+    }
+};
+
+JpegEncoder::JpegEncoder()
+    : context(std::make_unique<Context>()),
+      outputSize(0),
+      imageWidth(0),
+      imageHeight(0),
+      imageQuality(0),
+      imageFormat(InputFormat::RGB)
+{
+    jpeg_compress_struct& jpeg = context->jpeg;
+    jpeg = {0};
+    jpeg.err = jpeg_std_error(&context->jerr);
+    jpeg_create_compress(&jpeg);
+    jpeg.client_data = context.get();
+    context->buffer = &outputBuffer;
+    context->size = &outputSize;
+    context->dest.init_destination = Context::InitDestination;
+    context->dest.empty_output_buffer = Context::EmptyOutputBuffer;
+    context->dest.term_destination = Context::TermDestination;
+    jpeg.dest = &context->dest;
+}
+
+JpegEncoder::~JpegEncoder()
+{
+    jpeg_destroy_compress(&context->jpeg);
+}
+
+bool JpegEncoder::IsNativeFormat(InputFormat format) const
+{
+    if (format == InputFormat::RGB) {
+        return true;
+    }
+#ifdef JCS_EXTENSIONS
+    return true;
+#else
+    return false;
+#endif
+}
+
+void JpegEncoder::Configure(int32_t width, int32_t height, int quality, InputFormat format)
+{
+    jpeg_compress_struct& jpeg = context->jpeg;
+    jpeg.image_width = width;
+    jpeg.image_height = height;
+    jpeg.input_components = jpgPix;
+    jpeg.in_color_space = JCS_RGB;
+#ifdef JCS_EXTENSIONS
+    // libjpeg-turbo reads 4 bytes per pixel input and skips the padding byte itself.
+    if (format != InputFormat::RGB) {
+        jpeg.input_components = rgbaPix;
+        jpeg.in_color_space = (format == InputFormat::RGBA) ? JCS_EXT_RGBX : JCS_EXT_BGRX;
+    }
+#endif
+    jpeg_set_defaults(&jpeg);
+    jpeg_set_quality(&jpeg, quality, TRUE);
+    // Start with one byte per pixel, larger frames grow the buffer once and keep it.
+    size_t minBufferSize = static_cast<size_t>(width) * static_cast<size_t>(height);
+    if (outputBuffer.size() < minBufferSize) {
+        outputBuffer.resize(minBufferSize);
+    }
+    if (!IsNativeFormat(format)) {
+        rowBuffer.resize(static_cast<size_t>(width) * jpgPix);
+    }
+    imageWidth = width;
+    imageHeight = height;
+    imageQuality = quality;
+    imageFormat = format;
+    ILOG("JpegEncoder::Configure width: %d height: %d quality: %d", width, height, quality);
+}
+
+const uint8_t* JpegEncoder::GetScanline(const uint8_t* data, size_t stride, uint32_t line)
+{
+    const uint8_t* row = data + static_cast<size_t>(line) * stride;
+    if (IsNativeFormat(imageFormat)) {
+        return row;
+    }
+    if (imageFormat == InputFormat::RGBA) {
+        PixelConverter::RgbaToRgb(row, rowBuffer.data(), static_cast<size_t>(imageWidth));
+    } else {
+        PixelConverter::BgraToRgb(row, rowBuffer.data(), static_cast<size_t>(imageWidth));
+    }
+    return rowBuffer.data();
+}
+
+bool JpegEncoder::Encode(const uint8_t* data, int32_t width, int32_t height, int quality,
+                         InputFormat format, size_t stride)
+{
+    outputSize = 0;
+    if (data == nullptr || width < 1 || height < 1) {
+        ELOG("JpegEncoder::Encode the data, width or height is invalid value");
+        return false;
+    }
+    if (width != imageWidth || height != imageHeight || quality != imageQuality || format != imageFormat) {
+        Configure(width, height, quality, format);
+    }
+    if (stride == 0) {
+        stride = static_cast<size_t>(width) * (format == InputFormat::RGB ? jpgPix : rgbaPix);
+    }
+    jpeg_compress_struct& jpeg = context->jpeg;
+    jpeg_start_compress(&jpeg, TRUE);
+    JSAMPROW rowPointer[1];
+    while (jpeg.next_scanline < jpeg.image_height) {
+        rowPointer[0] = const_cast<JSAMPROW>(GetScanline(data, stride, jpeg.next_scanline));
+        jpeg_write_scanlines(&jpeg, rowPointer, 1);
+    }
+    jpeg_finish_compress(&jpeg);
+    return outputSize > 0;
+}
+
+const uint8_t* JpegEncoder::GetData() const
+{
+    return outputBuffer.data();
+}
+
+size_t JpegEncoder::GetSize() const
+{
+    return outputSize;
+}
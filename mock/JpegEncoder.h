@@ -0,0 +1,60 @@
+/*
+ * Copyright (c) 2023 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef JPEGENCODER_H
+#define JPEGENCODER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Long-lived jpeg encoder. The compress object, its quantization tables and the output buffer are kept
+// across frames and only rebuilt when the frame size or the quality changes.
+class JpegEncoder {
+public:
+    JpegEncoder();
+    ~JpegEncoder();
+    JpegEncoder(const JpegEncoder&) = delete;
+    JpegEncoder& operator=(const JpegEncoder&) = delete;
+
+    // Layout of the pixels handed to Encode. 4 bytes per pixel input is encoded without a staging frame.
+    enum class InputFormat { RGB = 0, RGBA, BGRA };
+
+    // stride is the distance in bytes between two rows, 0 means the rows are tightly packed.
+    bool Encode(const uint8_t* data, int32_t width, int32_t height, int quality,
+                InputFormat format = InputFormat::RGB, size_t stride = 0);
+    const uint8_t* GetData() const;
+    size_t GetSize() const;
+
+private:
+    struct Context;
+    void Configure(int32_t width, int32_t height, int quality, InputFormat format);
+    bool IsNativeFormat(InputFormat format) const;
+    const uint8_t* GetScanline(const uint8_t* data, size_t stride, uint32_t line);
+
+    std::unique_ptr<Context> context;
+    std::vector<uint8_t> outputBuffer;
+    std::vector<uint8_t> rowBuffer; // used when libjpeg can not read the input format directly
+    size_t outputSize;
+    int32_t imageWidth;
+    int32_t imageHeight;
+    int imageQuality;
+    InputFormat imageFormat;
+    const int jpgPix = 3; // jpg color components
+    const int rgbaPix = 4;
+};
+
+#endif // JPEGENCODER_H
@@ -0,0 +1,392 @@
+/*
+ * Copyright (c) 2023 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "LosslessEncoder.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "PreviewerEngineLog.h"
+
+namespace {
+constexpr size_t LZ4_MIN_MATCH = 4;
+constexpr size_t LZ4_LAST_LITERALS = 5;  // the block always ends with at least 5 literals
+constexpr size_t LZ4_MF_LIMIT = 12;      // no match may start in the last 12 bytes
+constexpr size_t LZ4_MAX_OFFSET = 65535;
+constexpr size_t LZ4_RUN_MASK = 15;
+constexpr size_t LZ4_MAX_LENGTH_BYTE = 255;
+constexpr int LZ4_TOKEN_SHIFT = 4;
+constexpr uint32_t LZ4_HASH_PRIME = 2654435761U;
+constexpr int LZ4_SKIP_TRIGGER = 6;      // the search step grows after 64 misses in a row
+constexpr int BITS_PER_BYTE = 8;
+constexpr int UINT32_BITS = 32;
+
+constexpr uint8_t QOI_OP_INDEX = 0x00;
+constexpr uint8_t QOI_OP_DIFF = 0x40;
+constexpr uint8_t QOI_OP_LUMA = 0x80;
+constexpr uint8_t QOI_OP_RUN = 0xc0;
+constexpr uint8_t QOI_OP_RGB = 0xfe;
+constexpr uint8_t QOI_OP_RGBA = 0xff;
+constexpr uint8_t QOI_CHANNELS = 4;
+constexpr uint8_t QOI_COLORSPACE_SRGB = 0;
+constexpr size_t QOI_HEADER_SIZE = 14;
+constexpr size_t QOI_INDEX_SIZE = 64;
+constexpr int QOI_MAX_RUN = 62;
+constexpr size_t QOI_MAX_PIXEL_SIZE = 5;  // QOI_OP_RGBA
+constexpr uint8_t QOI_PADDING[] = {0, 0, 0, 0, 0, 0, 0, 1};
+constexpr uint8_t OPAQUE = 255;
+
+struct Pixel {
+    uint8_t r;
+    uint8_t g;
+    uint8_t b;
+    uint8_t a;
+};
+
+inline bool operator==(const Pixel& left, const Pixel& right)
+{
+    return left.r == right.r && left.g == right.g && left.b == right.b && left.a == right.a;
+}
+
+inline uint32_t Read32(const uint8_t* data)
+{
+    uint32_t value;
+    std::memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+inline uint64_t Read64(const uint8_t* data)
+{
+    uint64_t value;
+    std::memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+inline uint8_t* WriteBigEndian32(uint8_t* op, uint32_t value)
+{
+    for (int shift = UINT32_BITS - BITS_PER_BYTE; shift >= 0; shift -= BITS_PER_BYTE) {
+        *op++ = static_cast<uint8_t>(value >> shift);
+    }
+    return op;
+}
+
+inline uint8_t* WriteLz4Length(uint8_t* op, size_t length)
+{
+    while (length >= LZ4_MAX_LENGTH_BYTE) {
+        *op++ = LZ4_MAX_LENGTH_BYTE;
+        length -= LZ4_MAX_LENGTH_BYTE;
+    }
+    *op++ = static_cast<uint8_t>(length);
+    return op;
+}
+
+uint8_t* WriteLz4Literals(uint8_t* op, uint8_t* token, const uint8_t* literals, size_t length)
+{
+    if (length >= LZ4_RUN_MASK) {
+        *token = static_cast<uint8_t>(LZ4_RUN_MASK << LZ4_TOKEN_SHIFT);
+        op = WriteLz4Length(op, length - LZ4_RUN_MASK);
+    } else {
+        *token = static_cast<uint8_t>(length << LZ4_TOKEN_SHIFT);
+    }
+    std::memcpy(op, literals, length);
+    return op + length;
+}
+
+// Little endian: the first differing byte is the lowest non zero byte of the xor.
+size_t GetMatchLength(const uint8_t* src, size_t ip, size_t ref, size_t limit)
+{
+    size_t length = LZ4_MIN_MATCH;
+    while (ip + length + sizeof(uint64_t) <= limit) {
+        uint64_t diff = Read64(src + ref + length) ^ Read64(src + ip + length);
+        if (diff != 0) {
+            return length + static_cast<size_t>(__builtin_ctzll(diff)) / BITS_PER_BYTE;
+        }
+        length += sizeof(uint64_t);
+    }
+    while (ip + length < limit && src[ref + length] == src[ip + length]) {
+        length++;
+    }
+    return length;
+}
+
+inline Pixel ReadPixel(const uint8_t* data, JpegEncoder::InputFormat format)
+{
+    switch (format) {
+        case JpegEncoder::InputFormat::BGRA:
+            return {data[2], data[1], data[0], data[3]}; // 2: red, 3: alpha
+        case JpegEncoder::InputFormat::RGBA:
+            return {data[0], data[1], data[2], data[3]}; // 2: blue, 3: alpha
+        default:
+            return {data[0], data[1], data[2], OPAQUE}; // 2: blue
+    }
+}
+
+inline size_t GetPixelSize(JpegEncoder::InputFormat format)
+{
+    return format == JpegEncoder::InputFormat::RGB ? 3 : 4; // 3: rgb, 4: rgba or bgra
+}
+}
+
+LosslessEncoder::LosslessEncoder() : hashTable(static_cast<size_t>(1) << LZ4_HASH_LOG, 0), outputSize(0) {}
+
+const uint8_t* LosslessEncoder::GetData() const
+{
+    return outputBuffer.data();
+}
+
+size_t LosslessEncoder::GetSize() const
+{
+    return outputSize;
+}
+
+size_t LosslessEncoder::GetLz4Bound(size_t size)
+{
+    const size_t reserve = 16;
+    return size + size / LZ4_MAX_LENGTH_BYTE + reserve;
+}
+
+size_t LosslessEncoder::GetMaxSize(int32_t width, int32_t height)
+{
+    size_t pixelCount = static_cast<size_t>(width) * static_cast<size_t>(height);
+    size_t qoiSize = QOI_HEADER_SIZE + pixelCount * QOI_MAX_PIXEL_SIZE + sizeof(QOI_PADDING);
+    return std::max(qoiSize, GetLz4Bound(pixelCount * 4)); // 4: rgba
+}
+
+bool LosslessEncoder::Pack(const uint8_t* data, int32_t width, int32_t height, JpegEncoder::InputFormat format,
+                           size_t stride, std::vector<uint8_t>& output)
+{
+    if (data == nullptr || width < 1 || height < 1) {
+        ELOG("LosslessEncoder the data, width or height is invalid value");
+        return false;
+    }
+    size_t pixelSize = GetPixelSize(format);
+    size_t rowSize = static_cast<size_t>(width) * rgbaPix;
+    if (stride == 0) {
+        stride = static_cast<size_t>(width) * pixelSize;
+    }
+    if (output.size() < rowSize * height) {
+        output.resize(rowSize * height);
+    }
+    for (int32_t y = 0; y < height; y++) {
+        const uint8_t* src = data + y * stride;
+        uint8_t* dst = output.data() + y * rowSize;
+        if (format == JpegEncoder::InputFormat::RGBA) {
+            std::memcpy(dst, src, rowSize);
+            continue;
+        }
+        for (int32_t x = 0; x < width; x++) {
+            Pixel pixel = ReadPixel(src + x * pixelSize, format);
+            std::memcpy(dst + x * rgbaPix, &pixel, sizeof(pixel));
+        }
+    }
+    return true;
+}
+
+bool LosslessEncoder::EncodeRaw(const uint8_t* data, int32_t width, int32_t height, JpegEncoder::InputFormat format,
+                                size_t stride)
+{
+    outputSize = 0;
+    if (!Pack(data, width, height, format, stride, outputBuffer)) {
+        return false;
+    }
+    outputSize = static_cast<size_t>(width) * height * rgbaPix;
+    return true;
+}
+
+bool LosslessEncoder::EncodeLz4(const uint8_t* data, int32_t width, int32_t height, JpegEncoder::InputFormat format,
+                                size_t stride)
+{
+    outputSize = 0;
+    if (!Pack(data, width, height, format, stride, packedBuffer)) {
+        return false;
+    }
+    CompressPacked(static_cast<size_t>(width) * height * rgbaPix);
+    return true;
+}
+
+bool LosslessEncoder::EncodeXorLz4(const uint8_t* data, int32_t width, int32_t height,
+                                   JpegEncoder::InputFormat format, size_t stride, uint8_t* reference,
+                                   size_t referenceStride, bool isKeyFrame)
+{
+    outputSize = 0;
+    if (reference == nullptr || !Pack(data, width, height, format, stride, packedBuffer)) {
+        return false;
+    }
+    size_t rowSize = static_cast<size_t>(width) * rgbaPix;
+    for (int32_t y = 0; y < height; y++) {
+        uint8_t* current = packedBuffer.data() + y * rowSize;
+        uint8_t* previous = reference + y * referenceStride;
+        if (isKeyFrame) {
+            std::memcpy(previous, current, rowSize);
+            continue;
+        }
+        // rowSize is a multiple of 4, the 8 byte loop leaves at most one pixel.
+        size_t pos = 0;
+        for (; pos + sizeof(uint64_t) <= rowSize; pos += sizeof(uint64_t)) {
+            uint64_t value = Read64(current + pos);
+            uint64_t delta = value ^ Read64(previous + pos);
+            std::memcpy(previous + pos, &value, sizeof(value));
+            std::memcpy(current + pos, &delta, sizeof(delta));
+        }
+        for (; pos < rowSize; pos += sizeof(uint32_t)) {
+            uint32_t value = Read32(current + pos);
+            uint32_t delta = value ^ Read32(previous + pos);
+            std::memcpy(previous + pos, &value, sizeof(value));
+            std::memcpy(current + pos, &delta, sizeof(delta));
+        }
+    }
+    CompressPacked(static_cast<size_t>(height) * rowSize);
+    return true;
+}
+
+void LosslessEncoder::CompressPacked(size_t packedSize)
+{
+    size_t bound = GetLz4Bound(packedSize);
+    if (outputBuffer.size() < bound) {
+        outputBuffer.resize(bound);
+    }
+    outputSize = CompressLz4(packedBuffer.data(), packedSize, outputBuffer.data());
+}
+
+// Greedy single pass LZ4 block compressor with a 64K entry hash table, like LZ4_compress_default.
+size_t LosslessEncoder::CompressLz4(const uint8_t* src, size_t srcSize, uint8_t* dst)
+{
+    uint8_t* op = dst;
+    size_t anchor = 0;
+    if (srcSize > LZ4_MF_LIMIT) {
+        std::fill(hashTable.begin(), hashTable.end(), 0);
+        size_t matchLimit = srcSize - LZ4_LAST_LITERALS;
+        size_t mfLimit = srcSize - LZ4_MF_LIMIT;
+        size_t ip = 0;
+        uint32_t searchCount = 1U << LZ4_SKIP_TRIGGER;
+        while (ip <= mfLimit) {
+            uint32_t sequence = Read32(src + ip);
+            uint32_t hash = (sequence * LZ4_HASH_PRIME) >> (UINT32_BITS - LZ4_HASH_LOG);
+            size_t ref = hashTable[hash];
+            hashTable[hash] = static_cast<uint32_t>(ip);
+            if (ref >= ip || ip - ref > LZ4_MAX_OFFSET || Read32(src + ref) != sequence) {
+                ip += searchCount++ >> LZ4_SKIP_TRIGGER;
+                continue;
+            }
+            searchCount = 1U << LZ4_SKIP_TRIGGER;
+            while (ip > anchor && ref > 0 && src[ip - 1] == src[ref - 1]) {
+                ip--;
+                ref--;
+            }
+            size_t matchLength = GetMatchLength(src, ip, ref, matchLimit);
+            uint8_t* token = op++;
+            op = WriteLz4Literals(op, token, src + anchor, ip - anchor);
+            size_t offset = ip - ref;
+            *op++ = static_cast<uint8_t>(offset);
+            *op++ = static_cast<uint8_t>(offset >> BITS_PER_BYTE);
+            size_t extraLength = matchLength - LZ4_MIN_MATCH;
+            if (extraLength >= LZ4_RUN_MASK) {
+                *token |= static_cast<uint8_t>(LZ4_RUN_MASK);
+                op = WriteLz4Length(op, extraLength - LZ4_RUN_MASK);
+            } else {
+                *token |= static_cast<uint8_t>(extraLength);
+            }
+            ip += matchLength;
+            anchor = ip;
+        }
+    }
+    uint8_t* token = op++;
+    op = WriteLz4Literals(op, token, src + anchor, srcSize - anchor);
+    return static_cast<size_t>(op - dst);
+}
+
+bool LosslessEncoder::EncodeQoi(const uint8_t* data, int32_t width, int32_t height, JpegEncoder::InputFormat format,
+                                size_t stride)
+{
+    outputSize = 0;
+    if (data == nullptr || width < 1 || height < 1) {
+        ELOG("LosslessEncoder::EncodeQoi the data, width or height is invalid value");
+        return false;
+    }
+    size_t pixelSize = GetPixelSize(format);
+    if (stride == 0) {
+        stride = static_cast<size_t>(width) * pixelSize;
+    }
+    size_t maxSize = GetMaxSize(width, height);
+    if (outputBuffer.size() < maxSize) {
+        outputBuffer.resize(maxSize);
+    }
+    uint8_t* op = outputBuffer.data();
+    const uint8_t magic[] = {'q', 'o', 'i', 'f'};
+    op = std::copy(magic, magic + sizeof(magic), op);
+    op = WriteBigEndian32(op, static_cast<uint32_t>(width));
+    op = WriteBigEndian32(op, static_cast<uint32_t>(height));
+    *op++ = QOI_CHANNELS;
+    *op++ = QOI_COLORSPACE_SRGB;
+
+    Pixel index[QOI_INDEX_SIZE] = {};
+    Pixel previous = {0, 0, 0, OPAQUE};
+    int run = 0;
+    for (int32_t y = 0; y < height; y++) {
+        const uint8_t* row = data + y * stride;
+        for (int32_t x = 0; x < width; x++) {
+            Pixel pixel = ReadPixel(row + x * pixelSize, format);
+            if (pixel == previous) {
+                if (++run == QOI_MAX_RUN) {
+                    *op++ = static_cast<uint8_t>(QOI_OP_RUN | (run - 1));
+                    run = 0;
+                }
+                continue;
+            }
+            if (run > 0) {
+                *op++ = static_cast<uint8_t>(QOI_OP_RUN | (run - 1));
+                run = 0;
+            }
+            // 3, 5, 7, 11: the QOI index hash
+            size_t position = (pixel.r * 3 + pixel.g * 5 + pixel.b * 7 + pixel.a * 11) % QOI_INDEX_SIZE;
+            if (index[position] == pixel) {
+                *op++ = static_cast<uint8_t>(QOI_OP_INDEX | position);
+            } else if (pixel.a == previous.a) {
+                index[position] = pixel;
+                int8_t dr = static_cast<int8_t>(pixel.r - previous.r);
+                int8_t dg = static_cast<int8_t>(pixel.g - previous.g);
+                int8_t db = static_cast<int8_t>(pixel.b - previous.b);
+                int8_t drg = static_cast<int8_t>(dr - dg);
+                int8_t dbg = static_cast<int8_t>(db - dg);
+                // Ranges and biases below are fixed by the QOI specification.
+                if (dr > -3 && dr < 2 && dg > -3 && dg < 2 && db > -3 && db < 2) { // 2, 3: diff range -2..1
+                    *op++ = static_cast<uint8_t>(QOI_OP_DIFF | (dr + 2) << 4 | (dg + 2) << 2 | (db + 2)); // 2, 4
+                } else if (drg > -9 && drg < 8 && dg > -33 && dg < 32 && dbg > -9 && dbg < 8) { // 8, 9, 32, 33
+                    *op++ = static_cast<uint8_t>(QOI_OP_LUMA | (dg + 32)); // 32: luma green bias
+                    *op++ = static_cast<uint8_t>((drg + 8) << 4 | (dbg + 8)); // 4, 8: luma red/blue bias
+                } else {
+                    *op++ = QOI_OP_RGB;
+                    *op++ = pixel.r;
+                    *op++ = pixel.g;
+                    *op++ = pixel.b;
+                }
+            } else {
+                index[position] = pixel;
+                *op++ = QOI_OP_RGBA;
+                *op++ = pixel.r;
+                *op++ = pixel.g;
+                *op++ = pixel.b;
+                *op++ = pixel.a;
+            }
+            previous = pixel;
+        }
+    }
+    if (run > 0) {
+        *op++ = static_cast<uint8_t>(QOI_OP_RUN | (run - 1));
+    }
+    op = std::copy(QOI_PADDING, QOI_PADDING + sizeof(QOI_PADDING), op);
+    outputSize = static_cast<size_t>(op - outputBuffer.data());
+    return true;
+}
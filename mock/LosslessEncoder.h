@@ -0,0 +1,69 @@
+/*
+ * Copyright (c) 2023 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LOSSLESSENCODER_H
+#define LOSSLESSENCODER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "JpegEncoder.h"
+
+// Pixel exact frame encoders. The output is always RGBA, whatever the input layout is:
+//   raw - tightly packed RGBA rows
+//   lz4 - packed RGBA rows compressed as one LZ4 block (the standard block format, no frame header)
+//   qoi - a complete QOI image with 4 channels
+//   xor - packed RGBA rows XORed with the same rows of the previous frame, compressed like lz4. Unchanged
+//         pixels become zero runs, so a frame where little changed compresses to a few hundred bytes.
+class LosslessEncoder {
+public:
+    LosslessEncoder();
+    ~LosslessEncoder() {}
+    LosslessEncoder(const LosslessEncoder&) = delete;
+    LosslessEncoder& operator=(const LosslessEncoder&) = delete;
+
+    // stride is the distance in bytes between two rows, 0 means the rows are tightly packed.
+    bool EncodeRaw(const uint8_t* data, int32_t width, int32_t height, JpegEncoder::InputFormat format,
+                   size_t stride = 0);
+    bool EncodeLz4(const uint8_t* data, int32_t width, int32_t height, JpegEncoder::InputFormat format,
+                   size_t stride = 0);
+    bool EncodeQoi(const uint8_t* data, int32_t width, int32_t height, JpegEncoder::InputFormat format,
+                   size_t stride = 0);
+    // reference holds the previous frame as packed RGBA rows of referenceStride bytes and is updated to this
+    // frame. A key frame only updates reference, the output is then the same as EncodeLz4.
+    bool EncodeXorLz4(const uint8_t* data, int32_t width, int32_t height, JpegEncoder::InputFormat format,
+                      size_t stride, uint8_t* reference, size_t referenceStride, bool isKeyFrame);
+    const uint8_t* GetData() const;
+    size_t GetSize() const;
+    // Upper bound of the encoded size of a width x height frame for all codecs.
+    static size_t GetMaxSize(int32_t width, int32_t height);
+
+private:
+    bool Pack(const uint8_t* data, int32_t width, int32_t height, JpegEncoder::InputFormat format,
+              size_t stride, std::vector<uint8_t>& output);
+    void CompressPacked(size_t packedSize);
+    size_t CompressLz4(const uint8_t* src, size_t srcSize, uint8_t* dst);
+    static size_t GetLz4Bound(size_t size);
+
+    static constexpr int LZ4_HASH_LOG = 16;
+    std::vector<uint8_t> packedBuffer;
+    std::vector<uint8_t> outputBuffer;
+    std::vector<uint32_t> hashTable;
+    size_t outputSize;
+    const int rgbaPix = 4;
+};
+
+#endif // LOSSLESSENCODER_H
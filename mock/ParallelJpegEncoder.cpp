@@ -0,0 +1,238 @@
+/*
+ * Copyright (c) 2023 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ParallelJpegEncoder.h"
+
+#include <algorithm>
+
+#include "PreviewerEngineLog.h"
+
+namespace {
+constexpr int32_t MCU_SIZE = 16;         // jpeg_set_defaults uses 2x2 luma sampling, one MCU is 16x16 pixels
+constexpr uint8_t MARKER_PREFIX = 0xFF;
+constexpr uint8_t MARKER_SOF0 = 0xC0;
+constexpr uint8_t MARKER_RST0 = 0xD0;
+constexpr uint8_t MARKER_SOI = 0xD8;
+constexpr uint8_t MARKER_EOI = 0xD9;
+constexpr uint8_t MARKER_SOS = 0xDA;
+constexpr uint8_t MARKER_DRI = 0xDD;
+constexpr uint8_t RST_MARKER_COUNT = 8;
+constexpr uint16_t DRI_LENGTH = 4;
+constexpr size_t MARKER_SIZE = 2;
+constexpr size_t SOF_HEIGHT_OFFSET = 5;  // marker(2) + length(2) + precision(1)
+constexpr int BITS_PER_BYTE = 8;
+constexpr uint16_t BYTE_MASK = 0xFF;
+}
+
+ParallelJpegEncoder::ParallelJpegEncoder(size_t stripCount)
+    : generation(0), pendingCount(0), isStopped(false)
+{
+    if (stripCount < 1) {
+        stripCount = 1;
+    }
+    for (size_t i = 0; i < stripCount; i++) {
+        encoders.push_back(std::make_unique<JpegEncoder>());
+    }
+    stripInfos.resize(stripCount);
+    stripResults.resize(stripCount, 0);
+    // Strip 0 is encoded by the calling thread.
+    for (size_t i = 1; i < stripCount; i++) {
+        workers.emplace_back(&ParallelJpegEncoder::WorkerLoop, this, i);
+    }
+    ILOG("ParallelJpegEncoder strip count: %zu", stripCount);
+}
+
+ParallelJpegEncoder::~ParallelJpegEncoder()
+{
+    {
+        std::lock_guard<std::mutex> guard(mutex);
+        isStopped = true;
+    }
+    startCondition.notify_all();
+    for (std::thread& worker : workers) {
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+}
+
+size_t ParallelJpegEncoder::GetStripCount() const
+{
+    return encoders.size();
+}
+
+void ParallelJpegEncoder::WorkerLoop(size_t index)
+{
+    uint64_t seenGeneration = 0;
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        startCondition.wait(lock, [this, seenGeneration]() { return isStopped || generation != seenGeneration; });
+        if (isStopped) {
+            return;
+        }
+        seenGeneration = generation;
+        if (index >= job.stripCount) {
+            continue;
+        }
+        Job stripJob = job;
+        lock.unlock();
+        bool result = EncodeStrip(index, stripJob);
+        lock.lock();
+        stripResults[index] = result ? 1 : 0;
+        if (--pendingCount == 0) {
+            doneCondition.notify_one();
+        }
+    }
+}
+
+bool ParallelJpegEncoder::EncodeStrip(size_t index, const Job& stripJob)
+{
+    int32_t startRow = static_cast<int32_t>(index) * stripJob.stripHeight;
+    int32_t rows = std::min(stripJob.stripHeight, stripJob.height - startRow);
+    JpegEncoder& encoder = *encoders[index];
+    const uint8_t* stripData = stripJob.data + static_cast<size_t>(startRow) * stripJob.stride;
+    if (!encoder.Encode(stripData, stripJob.width, rows, stripJob.quality, stripJob.format, stripJob.stride)) {
+        return false;
+    }
+    return ParseStrip(encoder.GetData(), encoder.GetSize(), stripInfos[index]);
+}
+
+bool ParallelJpegEncoder::Encode(const uint8_t* data, int32_t width, int32_t height, int quality,
+                                 JpegEncoder::InputFormat format, size_t stride)
+{
+    outputBuffer.clear();
+    if (data == nullptr || width < 1 || height < 1) {
+        ELOG("ParallelJpegEncoder::Encode the data, width or height is invalid value");
+        return false;
+    }
+    if (stride == 0) {
+        size_t pixelSize = (format == JpegEncoder::InputFormat::RGB) ? 3 : 4; // 3: rgb, 4: rgba or bgra
+        stride = static_cast<size_t>(width) * pixelSize;
+    }
+    // Every strip but the last one must cover a whole number of MCU rows to keep the restart interval fixed.
+    int32_t stripCount = static_cast<int32_t>(encoders.size());
+    int32_t mcuRows = (height + MCU_SIZE - 1) / MCU_SIZE;
+    int32_t stripHeight = ((mcuRows + stripCount - 1) / stripCount) * MCU_SIZE;
+    Job stripJob;
+    stripJob.data = data;
+    stripJob.width = width;
+    stripJob.height = height;
+    stripJob.stripHeight = stripHeight;
+    stripJob.stripCount = static_cast<size_t>((height + stripHeight - 1) / stripHeight);
+    stripJob.quality = quality;
+    stripJob.format = format;
+    stripJob.stride = stride;
+    {
+        std::lock_guard<std::mutex> guard(mutex);
+        job = stripJob;
+        pendingCount = stripJob.stripCount - 1;
+        generation++;
+    }
+    startCondition.notify_all();
+    stripResults[0] = EncodeStrip(0, stripJob) ? 1 : 0;
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        doneCondition.wait(lock, [this]() { return pendingCount == 0; });
+    }
+    for (size_t i = 0; i < stripJob.stripCount; i++) {
+        if (stripResults[i] == 0) {
+            ELOG("ParallelJpegEncoder::Encode strip %zu failed", i);
+            return false;
+        }
+    }
+    return Assemble(stripJob);
+}
+
+bool ParallelJpegEncoder::ParseStrip(const uint8_t* data, size_t size, StripInfo& info)
+{
+    if (size < MARKER_SIZE * 2 || data[0] != MARKER_PREFIX || data[1] != MARKER_SOI) {
+        return false;
+    }
+    info.sofPos = 0;
+    size_t pos = MARKER_SIZE;
+    while (pos + MARKER_SIZE * 2 <= size) {
+        if (data[pos] != MARKER_PREFIX) {
+            return false;
+        }
+        uint8_t marker = data[pos + 1];
+        size_t length = (static_cast<size_t>(data[pos + 2]) << BITS_PER_BYTE) | data[pos + 3]; // 2, 3: length
+        if (marker == MARKER_SOF0) {
+            info.sofPos = pos;
+        } else if (marker == MARKER_SOS) {
+            info.sosPos = pos;
+            info.scanStart = pos + MARKER_SIZE + length;
+            info.scanEnd = size - MARKER_SIZE; // the strip ends with EOI
+            return info.sofPos != 0 && info.scanStart <= info.scanEnd;
+        }
+        pos += MARKER_SIZE + length;
+    }
+    return false;
+}
+
+void ParallelJpegEncoder::AppendMarker(uint8_t marker)
+{
+    outputBuffer.push_back(MARKER_PREFIX);
+    outputBuffer.push_back(marker);
+}
+
+void ParallelJpegEncoder::AppendUint16(uint16_t value)
+{
+    outputBuffer.push_back(static_cast<uint8_t>(value >> BITS_PER_BYTE));
+    outputBuffer.push_back(static_cast<uint8_t>(value & BYTE_MASK));
+}
+
+bool ParallelJpegEncoder::Assemble(const Job& stripJob)
+{
+    const uint8_t* first = encoders[0]->GetData();
+    const StripInfo& firstInfo = stripInfos[0];
+    // Headers and tables of the first strip, with the frame height patched to the whole image.
+    outputBuffer.insert(outputBuffer.end(), first, first + firstInfo.sosPos);
+    size_t heightPos = firstInfo.sofPos + SOF_HEIGHT_OFFSET;
+    outputBuffer[heightPos] = static_cast<uint8_t>(static_cast<uint16_t>(stripJob.height) >> BITS_PER_BYTE);
+    outputBuffer[heightPos + 1] = static_cast<uint8_t>(static_cast<uint16_t>(stripJob.height) & BYTE_MASK);
+    // One restart interval per strip.
+    int32_t mcuColumns = (stripJob.width + MCU_SIZE - 1) / MCU_SIZE;
+    int32_t restartInterval = mcuColumns * (stripJob.stripHeight / MCU_SIZE);
+    if (stripJob.stripCount > 1 && restartInterval > UINT16_MAX) {
+        ELOG("ParallelJpegEncoder::Assemble restart interval %d is too large", restartInterval);
+        outputBuffer.clear();
+        return false;
+    }
+    if (stripJob.stripCount > 1) {
+        AppendMarker(MARKER_DRI);
+        AppendUint16(DRI_LENGTH);
+        AppendUint16(static_cast<uint16_t>(restartInterval));
+    }
+    outputBuffer.insert(outputBuffer.end(), first + firstInfo.sosPos, first + firstInfo.scanStart);
+    for (size_t i = 0; i < stripJob.stripCount; i++) {
+        const uint8_t* strip = encoders[i]->GetData();
+        outputBuffer.insert(outputBuffer.end(), strip + stripInfos[i].scanStart, strip + stripInfos[i].scanEnd);
+        if (i + 1 < stripJob.stripCount) {
+            AppendMarker(static_cast<uint8_t>(MARKER_RST0 + i % RST_MARKER_COUNT));
+        }
+    }
+    AppendMarker(MARKER_EOI);
+    return true;
+}
+
+const uint8_t* ParallelJpegEncoder::GetData() const
+{
+    return outputBuffer.data();
+}
+
+size_t ParallelJpegEncoder::GetSize() const
+{
+    return outputBuffer.size();
+}
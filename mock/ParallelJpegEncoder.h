@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) 2023 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef PARALLELJPEGENCODER_H
+#define PARALLELJPEGENCODER_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "JpegEncoder.h"
+
+// Splits a frame into horizontal strips that are encoded concurrently. The strips are joined with
+// restart markers into a single baseline jpeg, so clients decode it like any other frame.
+class ParallelJpegEncoder {
+public:
+    explicit ParallelJpegEncoder(size_t stripCount);
+    ~ParallelJpegEncoder();
+    ParallelJpegEncoder(const ParallelJpegEncoder&) = delete;
+    ParallelJpegEncoder& operator=(const ParallelJpegEncoder&) = delete;
+
+    bool Encode(const uint8_t* data, int32_t width, int32_t height, int quality,
+                JpegEncoder::InputFormat format = JpegEncoder::InputFormat::RGB, size_t stride = 0);
+    const uint8_t* GetData() const;
+    size_t GetSize() const;
+    size_t GetStripCount() const;
+
+private:
+    struct Job {
+        const uint8_t* data = nullptr;
+        int32_t width = 0;
+        int32_t height = 0;
+        int32_t stripHeight = 0;
+        size_t stripCount = 0;
+        int quality = 0;
+        JpegEncoder::InputFormat format = JpegEncoder::InputFormat::RGB;
+        size_t stride = 0;
+    };
+    struct StripInfo {
+        size_t sofPos = 0;       // start of the SOF0 segment
+        size_t sosPos = 0;       // start of the SOS segment
+        size_t scanStart = 0;    // first byte of the entropy coded data
+        size_t scanEnd = 0;      // one past the last byte of the entropy coded data
+    };
+
+    void WorkerLoop(size_t index);
+    bool EncodeStrip(size_t index, const Job& stripJob);
+    static bool ParseStrip(const uint8_t* data, size_t size, StripInfo& info);
+    bool Assemble(const Job& stripJob);
+    void AppendMarker(uint8_t marker);
+    void AppendUint16(uint16_t value);
+
+    std::vector<std::unique_ptr<JpegEncoder>> encoders;
+    std::vector<StripInfo> stripInfos;
+    std::vector<uint8_t> stripResults; // one byte per strip, workers write their own entry
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable startCondition;
+    std::condition_variable doneCondition;
+    Job job;
+    uint64_t generation;
+    size_t pendingCount;
+    bool isStopped;
+    std::vector<uint8_t> outputBuffer;
+};
+
+#endif // PARALLELJPEGENCODER_H
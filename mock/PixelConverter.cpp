@@ -0,0 +1,234 @@
+/*
+ * Copyright (c) 2023 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "PixelConverter.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define PIXEL_CONVERTER_X86
+#include <immintrin.h>
+#elif defined(__aarch64__) || defined(__ARM_NEON)
+#define PIXEL_CONVERTER_NEON
+#include <arm_neon.h>
+#endif
+
+#include "PreviewerEngineLog.h"
+
+namespace {
+constexpr size_t SRC_PIXEL_SIZE = 4;
+constexpr size_t DST_PIXEL_SIZE = 3;
+constexpr size_t RED_POS = 0;
+constexpr size_t GREEN_POS = 1;
+constexpr size_t BLUE_POS = 2;
+
+template <bool swapRedBlue>
+void ConvertScalar(const uint8_t* src, uint8_t* dst, size_t pixelCount)
+{
+    for (size_t i = 0; i < pixelCount; ++i) {
+        dst[RED_POS] = src[swapRedBlue ? BLUE_POS : RED_POS];
+        dst[GREEN_POS] = src[GREEN_POS];
+        dst[BLUE_POS] = src[swapRedBlue ? RED_POS : BLUE_POS];
+        src += SRC_PIXEL_SIZE;
+        dst += DST_PIXEL_SIZE;
+    }
+}
+
+#ifdef PIXEL_CONVERTER_X86
+// 16 pixels are handled per step: four 16 byte loads are packed into three 16 byte stores.
+constexpr size_t SSE_STEP_PIXELS = 16;
+constexpr size_t AVX_STEP_PIXELS = 32;
+constexpr int PACKED_BYTES = 12; // 4 pixels * 3 bytes in every 16 byte register
+constexpr int HALF_BYTES = 8;
+constexpr int QUARTER_BYTES = 4;
+
+template <bool swapRedBlue>
+__attribute__((target("ssse3"))) __m128i GetShuffleMask128()
+{
+    if (swapRedBlue) {
+        return _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+    }
+    return _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+}
+
+template <bool swapRedBlue>
+__attribute__((target("ssse3"))) void ConvertSsse3(const uint8_t* src, uint8_t* dst, size_t pixelCount)
+{
+    const __m128i mask = GetShuffleMask128<swapRedBlue>();
+    size_t i = 0;
+    for (; i + SSE_STEP_PIXELS <= pixelCount; i += SSE_STEP_PIXELS) {
+        const __m128i* in = reinterpret_cast<const __m128i*>(src + i * SRC_PIXEL_SIZE);
+        __m128i a = _mm_shuffle_epi8(_mm_loadu_si128(in), mask);
+        __m128i b = _mm_shuffle_epi8(_mm_loadu_si128(in + 1), mask);
+        __m128i c = _mm_shuffle_epi8(_mm_loadu_si128(in + 2), mask);
+        __m128i d = _mm_shuffle_epi8(_mm_loadu_si128(in + 3), mask);
+        __m128i* out = reinterpret_cast<__m128i*>(dst + i * DST_PIXEL_SIZE);
+        _mm_storeu_si128(out, _mm_or_si128(a, _mm_slli_si128(b, PACKED_BYTES)));
+        _mm_storeu_si128(out + 1, _mm_or_si128(_mm_srli_si128(b, QUARTER_BYTES), _mm_slli_si128(c, HALF_BYTES)));
+        _mm_storeu_si128(out + 2, _mm_or_si128(_mm_srli_si128(c, HALF_BYTES), _mm_slli_si128(d, QUARTER_BYTES)));
+    }
+    ConvertScalar<swapRedBlue>(src + i * SRC_PIXEL_SIZE, dst + i * DST_PIXEL_SIZE, pixelCount - i);
+}
+
+// Same packing as the SSSE3 path, the low lane carries pixels [0, 16) and the high lane [16, 32).
+template <bool swapRedBlue>
+__attribute__((target("avx2"))) void ConvertAvx2(const uint8_t* src, uint8_t* dst, size_t pixelCount)
+{
+    const __m128i mask128 = GetShuffleMask128<swapRedBlue>();
+    const __m256i mask = _mm256_inserti128_si256(_mm256_castsi128_si256(mask128), mask128, 1);
+    const size_t laneOffset = SSE_STEP_PIXELS * SRC_PIXEL_SIZE / sizeof(__m128i);
+    size_t i = 0;
+    for (; i + AVX_STEP_PIXELS <= pixelCount; i += AVX_STEP_PIXELS) {
+        const __m128i* in = reinterpret_cast<const __m128i*>(src + i * SRC_PIXEL_SIZE);
+        __m256i regs[QUARTER_BYTES];
+        for (int j = 0; j < QUARTER_BYTES; ++j) {
+            __m256i pixels = _mm256_castsi128_si256(_mm_loadu_si128(in + j));
+            pixels = _mm256_inserti128_si256(pixels, _mm_loadu_si128(in + laneOffset + j), 1);
+            regs[j] = _mm256_shuffle_epi8(pixels, mask);
+        }
+        __m256i out0 = _mm256_or_si256(regs[0], _mm256_bslli_epi128(regs[1], PACKED_BYTES));
+        __m256i out1 = _mm256_or_si256(_mm256_bsrli_epi128(regs[1], QUARTER_BYTES),
+                                       _mm256_bslli_epi128(regs[2], HALF_BYTES));
+        __m256i out2 = _mm256_or_si256(_mm256_bsrli_epi128(regs[2], HALF_BYTES),
+                                       _mm256_bslli_epi128(regs[3], QUARTER_BYTES));
+        __m128i* low = reinterpret_cast<__m128i*>(dst + i * DST_PIXEL_SIZE);
+        __m128i* high = reinterpret_cast<__m128i*>(dst + (i + SSE_STEP_PIXELS) * DST_PIXEL_SIZE);
+        _mm_storeu_si128(low, _mm256_castsi256_si128(out0));
+        _mm_storeu_si128(low + 1, _mm256_castsi256_si128(out1));
+        _mm_storeu_si128(low + 2, _mm256_castsi256_si128(out2));
+        _mm_storeu_si128(high, _mm256_extracti128_si256(out0, 1));
+        _mm_storeu_si128(high + 1, _mm256_extracti128_si256(out1, 1));
+        _mm_storeu_si128(high + 2, _mm256_extracti128_si256(out2, 1));
+    }
+    ConvertSsse3<swapRedBlue>(src + i * SRC_PIXEL_SIZE, dst + i * DST_PIXEL_SIZE, pixelCount - i);
+}
+#endif // PIXEL_CONVERTER_X86
+
+#ifdef PIXEL_CONVERTER_NEON
+constexpr size_t NEON_STEP_PIXELS = 16;
+
+template <bool swapRedBlue>
+void ConvertNeon(const uint8_t* src, uint8_t* dst, size_t pixelCount)
+{
+    size_t i = 0;
+    for (; i + NEON_STEP_PIXELS <= pixelCount; i += NEON_STEP_PIXELS) {
+        uint8x16x4_t in = vld4q_u8(src + i * SRC_PIXEL_SIZE);
+        uint8x16x3_t out;
+        out.val[RED_POS] = in.val[swapRedBlue ? BLUE_POS : RED_POS];
+        out.val[GREEN_POS] = in.val[GREEN_POS];
+        out.val[BLUE_POS] = in.val[swapRedBlue ? RED_POS : BLUE_POS];
+        vst3q_u8(dst + i * DST_PIXEL_SIZE, out);
+    }
+    ConvertScalar<swapRedBlue>(src + i * SRC_PIXEL_SIZE, dst + i * DST_PIXEL_SIZE, pixelCount - i);
+}
+#endif // PIXEL_CONVERTER_NEON
+}
+
+void PixelConverter::RgbaToRgb(const uint8_t* src, uint8_t* dst, size_t pixelCount)
+{
+    if (src == nullptr || dst == nullptr) {
+        ELOG("PixelConverter::RgbaToRgb invalid buffer");
+        return;
+    }
+    GetTable().rgbaToRgb(src, dst, pixelCount);
+}
+
+void PixelConverter::BgraToRgb(const uint8_t* src, uint8_t* dst, size_t pixelCount)
+{
+    if (src == nullptr || dst == nullptr) {
+        ELOG("PixelConverter::BgraToRgb invalid buffer");
+        return;
+    }
+    GetTable().bgraToRgb(src, dst, pixelCount);
+}
+
+PixelConverter::Variant PixelConverter::GetVariant()
+{
+    return GetTable().variant;
+}
+
+const char* PixelConverter::GetVariantName(Variant variant)
+{
+    switch (variant) {
+        case Variant::SSSE3:
+            return "ssse3";
+        case Variant::AVX2:
+            return "avx2";
+        case Variant::NEON:
+            return "neon";
+        default:
+            return "scalar";
+    }
+}
+
+const PixelConverter::ConvertTable& PixelConverter::GetTable()
+{
+    static const ConvertTable table = SelectTable();
+    return table;
+}
+
+bool PixelConverter::Convert(Variant variant, bool isBgra, const uint8_t* src, uint8_t* dst, size_t pixelCount)
+{
+    ConvertTable table;
+    if (src == nullptr || dst == nullptr || !GetVariantTable(variant, table)) {
+        return false;
+    }
+    (isBgra ? table.bgraToRgb : table.rgbaToRgb)(src, dst, pixelCount);
+    return true;
+}
+
+// Leaves table unchanged if the variant is not supported.
+bool PixelConverter::GetVariantTable(Variant variant, ConvertTable& table)
+{
+    switch (variant) {
+        case Variant::SCALAR:
+            table = {Variant::SCALAR, ConvertScalar<false>, ConvertScalar<true>};
+            return true;
+#if defined(PIXEL_CONVERTER_X86)
+        case Variant::SSSE3:
+            __builtin_cpu_init();
+            if (!__builtin_cpu_supports("ssse3")) {
+                return false;
+            }
+            table = {Variant::SSSE3, ConvertSsse3<false>, ConvertSsse3<true>};
+            return true;
+        case Variant::AVX2:
+            __builtin_cpu_init();
+            if (!__builtin_cpu_supports("avx2")) {
+                return false;
+            }
+            table = {Variant::AVX2, ConvertAvx2<false>, ConvertAvx2<true>};
+            return true;
+#elif defined(PIXEL_CONVERTER_NEON)
+        case Variant::NEON:
+            table = {Variant::NEON, ConvertNeon<false>, ConvertNeon<true>};
+            return true;
+#endif
+        default:
+            return false;
+    }
+}
+
+PixelConverter::ConvertTable PixelConverter::SelectTable()
+{
+    // Fastest first.
+    const Variant variants[] = {Variant::AVX2, Variant::SSSE3, Variant::NEON};
+    ConvertTable table = {Variant::SCALAR, ConvertScalar<false>, ConvertScalar<true>};
+    for (Variant variant : variants) {
+        if (GetVariantTable(variant, table)) {
+            break;
+        }
+    }
+    ILOG("PixelConverter use %s implementation", GetVariantName(table.variant));
+    return table;
+}
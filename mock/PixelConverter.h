@@ -0,0 +1,55 @@
+/*
+ * Copyright (c) 2023 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef PIXELCONVERTER_H
+#define PIXELCONVERTER_H
+
+#include <cstddef>
+#include <cstdint>
+
+// Converts 4 bytes per pixel frames into the 3 bytes per pixel layout used by the jpeg encoder.
+// The fastest implementation supported by the running cpu is selected once on first use.
+class PixelConverter {
+public:
+    enum class Variant { SCALAR = 0, SSSE3, AVX2, NEON };
+
+    PixelConverter() = delete;
+    PixelConverter(const PixelConverter&) = delete;
+    PixelConverter& operator=(const PixelConverter&) = delete;
+
+    // RGBA -> RGB, the alpha byte is dropped.
+    static void RgbaToRgb(const uint8_t* src, uint8_t* dst, size_t pixelCount);
+    // BGRA -> RGB, the red and blue bytes are swapped and the alpha byte is dropped.
+    static void BgraToRgb(const uint8_t* src, uint8_t* dst, size_t pixelCount);
+
+    static Variant GetVariant();
+    static const char* GetVariantName(Variant variant);
+    // Converts with the given variant instead of the selected one, used by tools/PixelConverterBench.cpp.
+    // Returns false if the build or the running cpu does not support the variant.
+    static bool Convert(Variant variant, bool isBgra, const uint8_t* src, uint8_t* dst, size_t pixelCount);
+
+private:
+    using ConvertFunc = void (*)(const uint8_t*, uint8_t*, size_t);
+    struct ConvertTable {
+        Variant variant;
+        ConvertFunc rgbaToRgb;
+        ConvertFunc bgraToRgb;
+    };
+    static const ConvertTable& GetTable();
+    static ConvertTable SelectTable();
+    static bool GetVariantTable(Variant variant, ConvertTable& table);
+};
+
+#endif // PIXELCONVERTER_H
@@ -0,0 +1,154 @@
+/*
+ * Copyright (c) 2023 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "QualityController.h"
+
+#include <algorithm>
+
+#include "PreviewerEngineLog.h"
+
+namespace {
+constexpr int64_t US_PER_MS = 1000;
+constexpr int64_t MS_PER_SECOND = 1000;
+constexpr int64_t PERCENT = 100;
+constexpr int32_t INTERVAL_PERCENT = 100;
+
+int64_t Average(int64_t average, int64_t sample, int64_t weight)
+{
+    return average + (sample - average) / weight;
+}
+}
+
+QualityController::QualityController()
+    : quality(0),
+      frameIntervalMs(0),
+      averageEncodeUs(0),
+      averageTransportUs(0),
+      averageBytes(0),
+      lastEncodeUs(0),
+      frameCount(0),
+      droppedCount(0),
+      throughputBytesPerSecond(0),
+      throughputAge(0)
+{
+}
+
+void QualityController::SetConfig(const Config& value)
+{
+    config = value;
+    quality = config.maxQuality;
+    frameIntervalMs = config.minFrameIntervalMs;
+    ILOG("QualityController quality: %d-%d frame interval: %d-%d ms", config.minQuality, config.maxQuality,
+         config.minFrameIntervalMs, config.maxFrameIntervalMs);
+}
+
+int QualityController::GetQuality() const
+{
+    return quality;
+}
+
+int32_t QualityController::GetFrameIntervalMs() const
+{
+    return frameIntervalMs;
+}
+
+std::chrono::milliseconds QualityController::GetWaitTime() const
+{
+    auto nextSendTime = lastSendTime + std::chrono::milliseconds(frameIntervalMs);
+    auto now = std::chrono::steady_clock::now();
+    if (now >= nextSendTime) {
+        return std::chrono::milliseconds(0);
+    }
+    return std::chrono::duration_cast<std::chrono::milliseconds>(nextSendTime - now);
+}
+
+void QualityController::OnEncoded(int64_t encodeUs, size_t bytes)
+{
+    lastEncodeUs = encodeUs;
+    averageBytes = Average(averageBytes, static_cast<int64_t>(bytes), AVERAGE_WEIGHT);
+}
+
+void QualityController::OnSent(int64_t transportUs, uint32_t dropped)
+{
+    lastSendTime = std::chrono::steady_clock::now();
+    averageEncodeUs = Average(averageEncodeUs, lastEncodeUs, AVERAGE_WEIGHT);
+    averageTransportUs = Average(averageTransportUs, transportUs, AVERAGE_WEIGHT);
+    droppedCount += dropped;
+    lastEncodeUs = 0;
+    if (++frameCount % ADJUST_PERIOD == 0) {
+        Adjust();
+    }
+}
+
+void QualityController::Adjust()
+{
+    // Frames waiting in a client queue add to the busy time, a skipped frame means the client fell behind
+    // a whole frame interval.
+    int64_t busyPercent = (averageEncodeUs + averageTransportUs) * PERCENT / (frameIntervalMs * US_PER_MS);
+    int64_t bytesPerSecond = GetBytesPerSecond(frameIntervalMs);
+    bool isBacklog = droppedCount > 0 || (busyPercent > HIGH_LOAD_PERCENT && averageTransportUs > averageEncodeUs);
+    if (isBacklog) {
+        // The transport did not keep up with this byte rate, which makes it an upper bound of its throughput.
+        if (throughputBytesPerSecond == 0 || bytesPerSecond < throughputBytesPerSecond) {
+            throughputBytesPerSecond = bytesPerSecond;
+        }
+        throughputAge = 0;
+    } else if (throughputBytesPerSecond > 0 && ++throughputAge >= THROUGHPUT_HOLD_PERIODS) {
+        throughputBytesPerSecond = 0;
+    }
+    // Larger frames at the same settings run into the throughput before the clients fall behind.
+    bool isHighLoad = busyPercent > HIGH_LOAD_PERCENT || isBacklog ||
+        (throughputBytesPerSecond > 0 && bytesPerSecond > throughputBytesPerSecond);
+    uint32_t dropped = droppedCount;
+    droppedCount = 0;
+    int oldQuality = quality;
+    int32_t oldInterval = frameIntervalMs;
+    if (isHighLoad) {
+        if (quality > config.minQuality) {
+            quality = std::max(quality - QUALITY_DOWN_STEP, config.minQuality);
+        } else {
+            int32_t step = std::max(frameIntervalMs * INTERVAL_UP_PERCENT / INTERVAL_PERCENT, 1);
+            frameIntervalMs = std::min(frameIntervalMs + step, config.maxFrameIntervalMs);
+        }
+    } else if (busyPercent < LOW_LOAD_PERCENT) {
+        // Frame rate comes back first, quality only once the full frame rate is reached. Quality adds a few
+        // bytes per frame, the margin below the throughput covers them.
+        if (frameIntervalMs > config.minFrameIntervalMs) {
+            int32_t step = std::max(frameIntervalMs * INTERVAL_DOWN_PERCENT / INTERVAL_PERCENT, 1);
+            int32_t interval = std::max(frameIntervalMs - step, config.minFrameIntervalMs);
+            if (IsBelowThroughput(GetBytesPerSecond(interval))) {
+                frameIntervalMs = interval;
+            }
+        } else if (IsBelowThroughput(bytesPerSecond)) {
+            quality = std::min(quality + QUALITY_UP_STEP, config.maxQuality);
+        }
+    }
+    if (quality != oldQuality || frameIntervalMs != oldInterval) {
+        ILOG("QualityController quality: %d frame interval: %d ms encode: %lld us transport: %lld us dropped: %u "
+             "bytes: %lld throughput: %lld bytes/s", quality, frameIntervalMs,
+             static_cast<long long>(averageEncodeUs), static_cast<long long>(averageTransportUs), dropped,
+             static_cast<long long>(averageBytes), static_cast<long long>(throughputBytesPerSecond));
+    }
+}
+
+int64_t QualityController::GetBytesPerSecond(int32_t intervalMs) const
+{
+    return averageBytes * MS_PER_SECOND / intervalMs;
+}
+
+bool QualityController::IsBelowThroughput(int64_t bytesPerSecond) const
+{
+    return throughputBytesPerSecond == 0 || bytesPerSecond * PERCENT <= throughputBytesPerSecond * HIGH_LOAD_PERCENT;
+}
@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) 2023 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef QUALITYCONTROLLER_H
+#define QUALITYCONTROLLER_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+// Feedback controller for the preview stream. It watches how long frames take to encode and to reach the
+// client, lowers the jpeg quality and then the frame rate when a frame does not fit into its
+// interval, and gives both back once the pipeline is idle again. The byte rate at which the transport fell
+// behind is kept as its throughput, giving quality or frame rate back must stay below it.
+class QualityController {
+public:
+    struct Config {
+        int minQuality = 0;
+        int maxQuality = 0;
+        int32_t minFrameIntervalMs = 0; // highest frame rate
+        int32_t maxFrameIntervalMs = 0; // lowest frame rate
+    };
+
+    QualityController();
+    ~QualityController() {}
+
+    void SetConfig(const Config& value);
+    int GetQuality() const;
+    int32_t GetFrameIntervalMs() const;
+    // Time left until the next frame may be sent, zero if a frame is due.
+    std::chrono::milliseconds GetWaitTime() const;
+    void OnEncoded(int64_t encodeUs, size_t bytes);
+    // transportUs is the time the frame took to reach the client, droppedCount the frames skipped because a
+    // client did not keep up.
+    void OnSent(int64_t transportUs, uint32_t droppedCount);
+
+private:
+    void Adjust();
+    int64_t GetBytesPerSecond(int32_t intervalMs) const;
+    bool IsBelowThroughput(int64_t bytesPerSecond) const;
+
+    static constexpr int QUALITY_DOWN_STEP = 5;
+    static constexpr int QUALITY_UP_STEP = 2;
+    static constexpr int32_t INTERVAL_UP_PERCENT = 25;
+    static constexpr int32_t INTERVAL_DOWN_PERCENT = 10;
+    static constexpr uint32_t ADJUST_PERIOD = 8;        // frames between two adjustments
+    static constexpr int64_t HIGH_LOAD_PERCENT = 90;    // busy share of the frame interval
+    static constexpr int64_t LOW_LOAD_PERCENT = 50;
+    static constexpr int64_t AVERAGE_WEIGHT = 4;        // moving averages take 1/4 of every new sample
+    // Adjustments without backlog until the throughput is forgotten and a faster transport may be found.
+    static constexpr uint32_t THROUGHPUT_HOLD_PERIODS = 16;
+
+    Config config;
+    int quality;
+    int32_t frameIntervalMs;
+    int64_t averageEncodeUs;
+    int64_t averageTransportUs;
+    int64_t averageBytes;
+    int64_t lastEncodeUs;
+    uint32_t frameCount;
+    uint32_t droppedCount; // since the last adjustment
+    int64_t throughputBytesPerSecond; // 0 while unknown
+    uint32_t throughputAge;
+    std::chrono::steady_clock::time_point lastSendTime;
+};
+
+#endif // QUALITYCONTROLLER_H
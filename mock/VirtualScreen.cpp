@@ -14,22 +14,28 @@
  */
 
 #include "VirtualScreen.h"
+
+#include <algorithm>
+
 #include "CommandParser.h"
 #include "CppTimerManager.h"
+#include "EndianUtil.h"
+#include "EventLoop.h"
+#include "FrameBufferPool.h"
+#include "FrameHash.h"
 #include "PreviewerEngineLog.h"
-#include "VirtualScreen.h"
-
-#define boolean jpegboolean
-#include "jpeglib.h"
-#undef boolean
+#include "SharedMemoryRing.h"
 
 using namespace std;
 
-uint32_t VirtualScreen::validFrameCountPerMinute = 0;
-uint32_t VirtualScreen::invalidFrameCountPerMinute = 0;
-uint32_t VirtualScreen::sendFrameCountPerMinute = 0;
-uint32_t VirtualScreen::inputKeyCountPerMinute = 0;
-uint32_t VirtualScreen::inputMethodCountPerMinute = 0;
+std::atomic<uint32_t> VirtualScreen::validFrameCountPerMinute(0);
+std::atomic<uint32_t> VirtualScreen::invalidFrameCountPerMinute(0);
+std::atomic<uint32_t> VirtualScreen::sendFrameCountPerMinute(0);
+std::atomic<uint32_t> VirtualScreen::staleFrameCountPerMinute(0);
+std::atomic<uint32_t> VirtualScreen::frameQueueDepthPerMinute(0);
+std::atomic<uint32_t> VirtualScreen::repeatedFrameCountPerMinute(0);
+std::atomic<uint32_t> VirtualScreen::inputKeyCountPerMinute(0);
+std::atomic<uint32_t> VirtualScreen::inputMethodCountPerMinute(0);
 bool VirtualScreen::isWebSocketListening = false;
 std::string VirtualScreen::webSocketPort = "";
 
@@ -48,9 +54,11 @@ VirtualScreen::VirtualScreen()
       frameCountTimer(nullptr),
       isWebSocketConfiged(false),
       currentRouter(""),
+      parallelJpegEncoder(nullptr),
       jpgScreenBuffer(nullptr),
       jpgBufferSize(0)
 {
+    framePacer.SetIntervalMs(sendPeriod);
 }
 
 VirtualScreen::~VirtualScreen()
@@ -126,9 +134,43 @@ void VirtualScreen::InitPipe(string pipeName, string pipePort)
 {
     webSocketPort = pipePort;
     isWebSocketConfiged = true;
+    std::string codec = CommandParser::GetInstance().GetFrameCodec();
+    if (codec == "raw") {
+        frameCodec = FrameCodec::RAW;
+    } else if (codec == "lz4") {
+        frameCodec = FrameCodec::LZ4;
+    } else if (codec == "qoi") {
+        frameCodec = FrameCodec::QOI;
+    } else if (codec == "delta") {
+        frameCodec = FrameCodec::DELTA;
+    }
+    encodedCodec = frameCodec;
+    if (CommandParser::GetInstance().IsAdaptiveQuality()) {
+        const int32_t msPerSecond = 1000;
+        QualityController::Config config;
+        config.minQuality = CommandParser::GetInstance().GetMinJpgQuality();
+        config.maxQuality = CommandParser::GetInstance().GetMaxJpgQuality();
+        config.minFrameIntervalMs = sendPeriod;
+        config.maxFrameIntervalMs = std::max(msPerSecond / CommandParser::GetInstance().GetMinFrameRate(), sendPeriod);
+        qualityController.SetConfig(config);
+        isAdaptiveQuality = true;
+    }
+    std::string sharedMemoryName = CommandParser::GetInstance().GetSharedMemoryName();
+    if (!sharedMemoryName.empty()) {
+        // Slots fit the largest frame of any resolution, so a resolution switch never has to replace the ring.
+        // Only the pages written by frames are backed by memory.
+        int32_t maxResolution = CommandParser::GetInstance().GetMaxResolution();
+        isSharedMemoryRing = SharedMemoryRing::GetInstance().Open(sharedMemoryName,
+            headSize + GetMaxEncodedSize(maxResolution, maxResolution));
+        if (isSharedMemoryRing) {
+            return;
+        }
+        ELOG("VirtualScreen::InitPipe shared memory ring failed, frames are sent through the WebSocket");
+    }
     WebSocketServer::GetInstance().SetServerPort(atoi(pipePort.c_str()));
     WebSocketServer::GetInstance().Run();
     isWebSocketListening = true;
+    EventLoop::WakeupAll(); // the command loop tells the client the port
 }
 
 void VirtualScreen::InitVirtualScreen()
@@ -180,19 +222,30 @@ void VirtualScreen::InitFrameCountTimer()
 
 void VirtualScreen::PrintFrameCount()
 {
-    if ((validFrameCountPerMinute | invalidFrameCountPerMinute | sendFrameCountPerMinute |
-        inputKeyCountPerMinute | inputMethodCountPerMinute) == 0) {
+    const double msPerSecond = 1000.0;
+    uint64_t bufferAllocCount = FrameBufferPool::GetInstance().TakeAllocationCount();
+    uint32_t validFrameCount = validFrameCountPerMinute.exchange(0);
+    uint32_t invalidFrameCount = invalidFrameCountPerMinute.exchange(0);
+    uint32_t sendFrameCount = sendFrameCountPerMinute.exchange(0);
+    uint32_t staleFrameCount = staleFrameCountPerMinute.exchange(0);
+    uint32_t frameQueueDepth = frameQueueDepthPerMinute.exchange(0);
+    uint32_t repeatedFrameCount = repeatedFrameCountPerMinute.exchange(0);
+    uint32_t inputKeyCount = inputKeyCountPerMinute.exchange(0);
+    uint32_t inputMethodCount = inputMethodCountPerMinute.exchange(0);
+    if ((validFrameCount | invalidFrameCount | sendFrameCount | inputKeyCount | inputMethodCount |
+        staleFrameCount | repeatedFrameCount | bufferAllocCount) == 0) {
         return;
     }
 
-    ELOG("ValidFrameCount: %d InvalidFrameCount: %d SendFrameCount: %d inputKeyCount: %d\
-         inputMethodCount: %d", validFrameCountPerMinute, invalidFrameCountPerMinute,
-         sendFrameCountPerMinute, inputKeyCountPerMinute, inputMethodCountPerMinute);
-    validFrameCountPerMinute = 0;
-    invalidFrameCountPerMinute = 0;
-    sendFrameCountPerMinute = 0;
-    inputKeyCountPerMinute = 0;
-    inputMethodCountPerMinute = 0;
+    ELOG("ValidFrameCount: %u InvalidFrameCount: %u SendFrameCount: %u inputKeyCount: %u\
+         inputMethodCount: %u", validFrameCount, invalidFrameCount, sendFrameCount, inputKeyCount,
+         inputMethodCount);
+    ELOG("FrameBufferAllocCount: %llu (%.2f per second) FrameBufferAcquireCount: %llu",
+         static_cast<unsigned long long>(bufferAllocCount),
+         static_cast<double>(bufferAllocCount) * msPerSecond / frameCountPeriod,
+         static_cast<unsigned long long>(FrameBufferPool::GetInstance().GetAcquireCount()));
+    ELOG("StaleFrameCount: %u RepeatedFrameCount: %u FrameQueuePeakDepth: %u", staleFrameCount,
+         repeatedFrameCount, frameQueueDepth);
 }
 
 
@@ -208,6 +261,9 @@ VirtualScreen::LoadDocType VirtualScreen::GetLoadDocFlag() const
 
 int VirtualScreen::GetJpgQualityValue(int32_t width, int32_t height) const
 {
+    if (isAdaptiveQuality) {
+        return qualityController.GetQuality();
+    }
     long long pixCount = static_cast<long long>(width) * static_cast<long long>(height);
     if (pixCount <= static_cast<int>(JpgPixCountLevel::LOWCOUNT)) {
         return static_cast<int>(JpgQualityLevel::HIGHLEVEL);
@@ -234,22 +290,82 @@ void VirtualScreen::SetFastPreviewMsg(const std::string msg)
 
 void VirtualScreen::SetDropFrameFrequency(const int32_t& value)
 {
-    dropFrameFrequency = value;
-    startDropFrameTime = std::chrono::system_clock::now();
+    framePacer.SetIntervalMs(std::max(value, sendPeriod));
+    ILOG("VirtualScreen frame interval: %d ms", framePacer.GetIntervalMs());
 }
 
-bool VirtualScreen::JudgeAndDropFrame()
+std::chrono::milliseconds VirtualScreen::GetSendWaitTime() const
 {
-    if (dropFrameFrequency <= 0) {
+    std::chrono::milliseconds waitTime = framePacer.GetWaitTime();
+    if (isAdaptiveQuality) {
+        waitTime = std::max(waitTime, qualityController.GetWaitTime());
+    }
+    return waitTime;
+}
+
+bool VirtualScreen::IsKeyFrameRequired()
+{
+    // Frames are dropped while no websocket client is connected, the one a client gets first has to be complete.
+    if (!isSharedMemoryRing && WebSocketServer::webSocketWritable != WebSocketServer::WebSocketState::WRITEABLE) {
+        return true;
+    }
+    uint32_t connectionCount = GetKeyFrameRequestCount();
+    if (connectionCount != keyFrameConnectionCount) {
+        keyFrameConnectionCount = connectionCount;
+        return true;
+    }
+    return regionFrameCount >= keyFrameInterval;
+}
+
+bool VirtualScreen::IsKeyFrameRequested() const
+{
+    // Otherwise every frame is a key frame and a new websocket client starts with the last one.
+    if (!HasDependentFrames()) {
         return false;
     }
-    auto endTime = std::chrono::system_clock::now();
-    int64_t timePassed = chrono::duration_cast<chrono::milliseconds>(endTime -
-                        startDropFrameTime).count();
-    if (timePassed >= dropFrameFrequency) {
-        startDropFrameTime = std::chrono::system_clock::now();
+    if (!isSharedMemoryRing && WebSocketServer::webSocketWritable != WebSocketServer::WebSocketState::WRITEABLE) {
+        return false;
+    }
+    return GetKeyFrameRequestCount() != keyFrameConnectionCount;
+}
+
+bool VirtualScreen::HasDependentFrames() const
+{
+    return CommandParser::GetInstance().IsRegionRefresh() || frameCodec == FrameCodec::DELTA;
+}
+
+uint32_t VirtualScreen::GetKeyFrameRequestCount() const
+{
+    // A client that could not get a region or delta frame in time asks for a full frame the same way.
+    if (isSharedMemoryRing) {
+        return SharedMemoryRing::GetInstance().GetAttachCount();
+    }
+    return WebSocketServer::connectionCount + WebSocketServer::keyFrameRequestCount;
+}
+
+void VirtualScreen::UpdateKeyFrameState(bool isKeyFrame)
+{
+    regionFrameCount = isKeyFrame ? 0 : regionFrameCount + 1;
+}
+
+bool VirtualScreen::IsRepeatedFrame(const uint8_t* data, size_t length, int32_t width, int32_t height)
+{
+    const int sizeShift = 32;
+    uint64_t seed = (static_cast<uint64_t>(static_cast<uint32_t>(width)) << sizeShift) |
+                    static_cast<uint32_t>(height);
+    uint64_t hash = FrameHash::Compute(data, length, seed);
+    if (isLastFrameHashValid && hash == lastFrameHash) {
+        repeatedFrameCountPerMinute++;
+        return true;
     }
-    return timePassed < dropFrameFrequency;
+    lastFrameHash = hash;
+    isLastFrameHashValid = true;
+    return false;
+}
+
+void VirtualScreen::ClearLastFrameHash()
+{
+    isLastFrameHashValid = false;
 }
 
 bool VirtualScreen::JudgeStaticImage(const int duration)
@@ -291,29 +407,168 @@ bool VirtualScreen::StopSendStaticCardImage(const int duration)
     return false;
 }
 
-void VirtualScreen::RgbToJpg(unsigned char* data, const int32_t width, const int32_t height)
+void VirtualScreen::RgbToJpg(const uint8_t* data, const int32_t width, const int32_t height,
+                             JpegEncoder::InputFormat format, size_t stride)
 {
     if (width < 1 || height < 1) {
         FLOG("VirtualScreenImpl::RgbToJpg the width or height is invalid value");
     }
-    jpeg_compress_struct jpeg = {0};
-    jpeg_error_mgr jerr;
-    jpeg.err = jpeg_std_error(&jerr);
-    jpeg_create_compress(&jpeg);
-    jpeg_mem_dest(&jpeg, &jpgScreenBuffer, &jpgBufferSize);
-    jpeg.image_width = width;
-    jpeg.image_height = height;
-    jpeg.input_components = jpgPix;
-    jpeg.in_color_space = JCS_RGB;
-    jpeg_set_defaults(&jpeg);
-    jpeg_set_quality(&jpeg, GetJpgQualityValue(width, height), TRUE);
-    jpeg_start_compress(&jpeg, TRUE);
-    JSAMPROW rowPointer[1];
-    int rowStride = width * jpgPix;
-    while (jpeg.next_scanline < jpeg.image_height) {
-        rowPointer[0] = &data[jpeg.next_scanline * rowStride];
-        jpeg_write_scanlines(&jpeg, rowPointer, 1);
-    }
-    jpeg_finish_compress(&jpeg);
-    jpeg_destroy_compress(&jpeg);
-}
\ No newline at end of file
+    int quality = GetJpgQualityValue(width, height);
+    uint32_t stripCount = CommandParser::GetInstance().GetJpegStripCount();
+    if (stripCount > 1 && static_cast<int64_t>(width) * height >= parallelJpegMinPixels) {
+        if (parallelJpegEncoder == nullptr) {
+            parallelJpegEncoder = std::make_unique<ParallelJpegEncoder>(stripCount);
+        }
+        parallelJpegEncoder->Encode(data, width, height, quality, format, stride);
+        jpgScreenBuffer = parallelJpegEncoder->GetData();
+        jpgBufferSize = parallelJpegEncoder->GetSize();
+    } else {
+        jpegEncoder.Encode(data, width, height, quality, format, stride);
+        jpgScreenBuffer = jpegEncoder.GetData();
+        jpgBufferSize = jpegEncoder.GetSize();
+    }
+}
+
+void VirtualScreen::EncodeFrame(const uint8_t* data, const int32_t width, const int32_t height,
+                                JpegEncoder::InputFormat format, size_t stride, const EncodeRect& rect)
+{
+    auto encodeStart = PerfStats::Clock::now();
+    encodedCodec = frameCodec;
+    isEncodedKeyFrame = rect.isKeyFrame;
+    switch (frameCodec) {
+        case FrameCodec::RAW:
+            losslessEncoder.EncodeRaw(data, width, height, format, stride);
+            break;
+        case FrameCodec::LZ4:
+            losslessEncoder.EncodeLz4(data, width, height, format, stride);
+            break;
+        case FrameCodec::QOI:
+            losslessEncoder.EncodeQoi(data, width, height, format, stride);
+            break;
+        case FrameCodec::DELTA:
+            EncodeDelta(data, width, height, format, stride, rect);
+            break;
+        default:
+            RgbToJpg(data, width, height, format, stride);
+            break;
+    }
+    if (frameCodec != FrameCodec::JPEG) {
+        jpgScreenBuffer = losslessEncoder.GetData();
+        jpgBufferSize = losslessEncoder.GetSize();
+    }
+    int64_t encodeUs = chrono::duration_cast<chrono::microseconds>(PerfStats::Clock::now() - encodeStart).count();
+    PerfStats::GetInstance().Record(PerfStats::Stage::ENCODE, encodeUs);
+    if (isAdaptiveQuality) {
+        qualityController.OnEncoded(encodeUs, jpgBufferSize);
+    }
+}
+
+void VirtualScreen::EncodeDelta(const uint8_t* data, const int32_t width, const int32_t height,
+                                JpegEncoder::InputFormat format, size_t stride, const EncodeRect& rect)
+{
+    int32_t frameWidth = rect.frameWidth > 0 ? rect.frameWidth : width;
+    int32_t frameHeight = rect.frameHeight > 0 ? rect.frameHeight : height;
+    if (rect.x < 0 || rect.y < 0 || width < 1 || height < 1 || rect.x > frameWidth - width ||
+        rect.y > frameHeight - height) {
+        ELOG("VirtualScreen::EncodeDelta the rect is out of the frame, sent as lz4");
+        isDeltaReferenceValid = false;
+        encodedCodec = FrameCodec::LZ4;
+        losslessEncoder.EncodeLz4(data, width, height, format, stride);
+        return;
+    }
+    if (frameWidth != deltaReferenceWidth || frameHeight != deltaReferenceHeight) {
+        deltaReferenceWidth = frameWidth;
+        deltaReferenceHeight = frameHeight;
+        deltaReference.assign(static_cast<size_t>(frameWidth) * frameHeight * pixelSize, 0);
+        isDeltaReferenceValid = false;
+    }
+    // Without a reference the rect is sent as lz4. Only a full frame makes a new reference, a region has to
+    // wait for the next full frame.
+    bool isKeyFrame = rect.isKeyFrame || !isDeltaReferenceValid;
+    if (isKeyFrame) {
+        isDeltaReferenceValid = width == frameWidth && height == frameHeight;
+    }
+    isEncodedKeyFrame = isKeyFrame && isDeltaReferenceValid;
+    encodedCodec = isKeyFrame ? FrameCodec::LZ4 : FrameCodec::DELTA;
+    size_t referenceStride = static_cast<size_t>(frameWidth) * pixelSize;
+    uint8_t* reference = deltaReference.data() + rect.y * referenceStride + static_cast<size_t>(rect.x) * pixelSize;
+    losslessEncoder.EncodeXorLz4(data, width, height, format, stride, reference, referenceStride, isKeyFrame);
+}
+
+void VirtualScreen::WriteFrameCodec(uint8_t* header) const
+{
+    uint16_t codec = EndianUtil::ToNetworkEndian<uint16_t>(static_cast<uint16_t>(encodedCodec));
+    std::copy_n(reinterpret_cast<const uint8_t*>(&codec), sizeof(codec), header + headCodecPos);
+}
+
+bool VirtualScreen::IsEncodedKeyFrame() const
+{
+    return isEncodedKeyFrame;
+}
+
+size_t VirtualScreen::GetMaxEncodedSize(int32_t width, int32_t height) const
+{
+    size_t frameSize = static_cast<size_t>(width) * static_cast<size_t>(height) * pixelSize;
+    if (frameCodec == FrameCodec::JPEG) {
+        return frameSize;
+    }
+    return std::max(frameSize, LosslessEncoder::GetMaxSize(width, height));
+}
+
+bool VirtualScreen::GetScaledSize(int32_t width, int32_t height, int32_t& scaledWidth, int32_t& scaledHeight) const
+{
+    scaledWidth = width;
+    scaledHeight = height;
+    // Frames are never scaled up, a frame smaller in one direction, e.g. one rendered before a rotation,
+    // is sent as it is.
+    if (compressionResolutionWidth < 1 || compressionResolutionHeight < 1 ||
+        compressionResolutionWidth > width || compressionResolutionHeight > height ||
+        (compressionResolutionWidth == width && compressionResolutionHeight == height)) {
+        return false;
+    }
+    scaledWidth = compressionResolutionWidth;
+    scaledHeight = compressionResolutionHeight;
+    return true;
+}
+
+size_t VirtualScreen::WriteFrame(SharedFramePtr frame, bool isKeyFrame)
+{
+    if (frame == nullptr) {
+        return 0;
+    }
+    auto sendStart = PerfStats::Clock::now();
+    size_t writed = 0;
+    if (isSharedMemoryRing) {
+        writed = SharedMemoryRing::GetInstance().WriteData(frame->GetData(), frame->GetSize());
+    } else {
+        // A new client only gets the last key frame, a region frame must not replace it.
+        if (isKeyFrame) {
+            WebSocketServer::GetInstance().SetLastFrame(frame);
+        }
+        writed = WebSocketServer::GetInstance().WriteData(std::move(frame), isKeyFrame);
+    }
+    framePacer.OnFrameSent();
+    int64_t sendUs = chrono::duration_cast<chrono::microseconds>(PerfStats::Clock::now() - sendStart).count();
+    PerfStats::GetInstance().Record(PerfStats::Stage::WRITE, sendUs);
+    if (writed > 0) {
+        PerfStats::GetInstance().AddSentFrame(writed);
+    }
+    if (isAdaptiveQuality) {
+        // Copying into the ring is all the shared memory transport costs, WriteData of the websocket never blocks
+        // and its clients report their backlog instead.
+        if (isSharedMemoryRing) {
+            qualityController.OnSent(sendUs, 0);
+        } else {
+            WebSocketServer::Backlog backlog = WebSocketServer::GetInstance().TakeBacklog();
+            qualityController.OnSent(backlog.maxQueueUs, backlog.droppedCount);
+        }
+    }
+    return writed;
+}
+
+void VirtualScreen::ReleaseFrames() const
+{
+    if (isWebSocketListening) {
+        WebSocketServer::GetInstance().ReleaseFrames();
+    }
+}
@@ -20,9 +20,17 @@
 #include <cstdint>
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "CppTimer.h"
+#include "FramePacer.h"
+#include "FrameScaler.h"
+#include "JpegEncoder.h"
 #include "LocalSocket.h"
+#include "LosslessEncoder.h"
+#include "ParallelJpegEncoder.h"
+#include "PerfStats.h"
+#include "QualityController.h"
 #include "WebSocketServer.h"
 
 class VirtualScreen {
@@ -74,6 +82,18 @@ public:
     VirtualScreen::LoadDocType GetLoadDocFlag() const;
 
     enum class ProtocolVersion { LOADNORMAL = 2, LOADDOC = 3 };
+    // Written to the last two reserved header bytes, 0 keeps clients that only know jpeg working.
+    // DELTA frames are lz4 blocks of the frame rect XORed with the same rect of the previous frame, the key
+    // frames of -codec delta are sent as LZ4 so they can be decoded without any earlier frame.
+    enum class FrameCodec { JPEG = 0, RAW = 1, LZ4 = 2, QOI = 3, DELTA = 4 };
+    // Where the encoded pixels lie in the sent frame, only used by the delta codec.
+    struct EncodeRect {
+        int32_t x = 0;
+        int32_t y = 0;
+        int32_t frameWidth = 0;
+        int32_t frameHeight = 0;
+        bool isKeyFrame = true;
+    };
 
     enum class JpgPixCountLevel { LOWCOUNT = 100000, MIDDLECOUNT = 300000, HIGHCOUNT = 500000};
     enum class JpgQualityLevel { HIGHLEVEL = 100, MIDDLELEVEL = 90, LOWLEVEL = 85, DEFAULTLEVEL = 75};
@@ -83,22 +103,55 @@ public:
 
     std::string GetFastPreviewMsg() const;
     void SetFastPreviewMsg(const std::string msg);
-    bool JudgeAndDropFrame();
+    // Frames are sent at most once per value ms, but never faster than sendPeriod.
     void SetDropFrameFrequency(const int32_t& value);
+    // Time left until the next frame may be sent, rendered frames are coalesced meanwhile.
+    std::chrono::milliseconds GetSendWaitTime() const;
     static bool JudgeStaticImage(const int duration);
     static bool StopSendStaticCardImage(const int duration);
-    void RgbToJpg(unsigned char* data, const int32_t width, const int32_t height);
-    static uint32_t inputKeyCountPerMinute;
-    static uint32_t inputMethodCountPerMinute;
+    void RgbToJpg(const uint8_t* data, const int32_t width, const int32_t height,
+                  JpegEncoder::InputFormat format = JpegEncoder::InputFormat::RGB, size_t stride = 0);
+    // Encodes with the codec selected by -codec, the result is left in jpgScreenBuffer and jpgBufferSize.
+    void EncodeFrame(const uint8_t* data, const int32_t width, const int32_t height,
+                     JpegEncoder::InputFormat format, size_t stride, const EncodeRect& rect);
+    // Writes the codec of the last encoded frame to the header, delta key frames differ from -codec.
+    void WriteFrameCodec(uint8_t* header) const;
+    // The delta codec sends a key frame on its own when it has no reference for the frame.
+    bool IsEncodedKeyFrame() const;
+    size_t GetMaxEncodedSize(int32_t width, int32_t height) const;
+    // Region refresh and delta codec: a new client or a long run of region frames needs a full frame next.
+    bool IsKeyFrameRequired();
+    void UpdateKeyFrameState(bool isKeyFrame);
+    // True if a client connected or asked for a key frame since the last one while region or delta frames are
+    // sent: the current frame has to be sent again as a key frame, even if nothing was rendered.
+    bool IsKeyFrameRequested() const;
+    // Region refresh and delta frames only apply on top of the previous frame.
+    bool HasDependentFrames() const;
+    // Returns true if the frame content equals the last recorded frame, records the frame otherwise.
+    bool IsRepeatedFrame(const uint8_t* data, size_t length, int32_t width, int32_t height);
+    void ClearLastFrameHash();
+    // Returns true if a frame of this size has to be scaled down to the compression resolution.
+    bool GetScaledSize(int32_t width, int32_t height, int32_t& scaledWidth, int32_t& scaledHeight) const;
+    // Writes a frame to the shared memory ring or queues it for the websocket clients, the time it takes feeds
+    // the adaptive quality controller. Key frames are kept for clients that connect later.
+    size_t WriteFrame(SharedFramePtr frame, bool isKeyFrame);
+    // Drops the frames kept by the WebSocket server once no more frames are written, before main returns.
+    void ReleaseFrames() const;
+    static std::atomic<uint32_t> inputKeyCountPerMinute;
+    static std::atomic<uint32_t> inputMethodCountPerMinute;
 
 protected:
     int32_t orignalResolutionWidth;
     int32_t orignalResolutionHeight;
     int32_t compressionResolutionWidth;
     int32_t compressionResolutionHeight;
-    static uint32_t validFrameCountPerMinute;
-    static uint32_t invalidFrameCountPerMinute;
-    static uint32_t sendFrameCountPerMinute;
+    // Counted by the render, encode and command threads and taken by the frame count timer.
+    static std::atomic<uint32_t> validFrameCountPerMinute;
+    static std::atomic<uint32_t> invalidFrameCountPerMinute;
+    static std::atomic<uint32_t> sendFrameCountPerMinute;
+    static std::atomic<uint32_t> staleFrameCountPerMinute;   // frames dropped by the encode queue
+    static std::atomic<uint32_t> frameQueueDepthPerMinute;   // peak depth of the encode queue
+    static std::atomic<uint32_t> repeatedFrameCountPerMinute; // frames skipped because their content did not change
 
     LocalSocket* screenSocket;
     std::unique_ptr<CppTimer> frameCountTimer;
@@ -108,13 +161,27 @@ protected:
     const size_t headSize = 40;                 // The packet header length is 40 bytes.
     const size_t headReservedSize = 20;         // The reserved length of the packet header is 20 bytes.
     const uint32_t headStart = 0x12345678;      // Buffer header starts with magic value 0x12345678
-    const int32_t frameCountPeriod = 60 * 1000; // Frame count per minute
+    const size_t headCodecPos = 38;             // FrameCodec is stored in the last 2 bytes of the header
+    static constexpr int32_t frameCountPeriod = 60 * 1000; // Frame count per minute
     uint16_t protocolVersion = static_cast<uint16_t>(VirtualScreen::ProtocolVersion::LOADNORMAL);
     bool isWebSocketConfiged;
+    bool isSharedMemoryRing = false; // -shm: frames go to SharedMemoryRing, the WebSocket server is not started
     std::string currentRouter;
     std::string abilityCurrentRouter;
     std::string fastPreviewMsg;
-    uint8_t* jpgScreenBuffer;
+    static constexpr int64_t parallelJpegMinPixels = 1024 * 1024; // smaller frames are encoded on one thread
+    JpegEncoder jpegEncoder;
+    std::unique_ptr<ParallelJpegEncoder> parallelJpegEncoder;
+    LosslessEncoder losslessEncoder;
+    FrameScaler frameScaler;
+    FrameCodec frameCodec = FrameCodec::JPEG;
+    FrameCodec encodedCodec = FrameCodec::JPEG; // codec of the last encoded frame
+    std::vector<uint8_t> deltaReference; // last frame sent with -codec delta, packed RGBA rows
+    int32_t deltaReferenceWidth = 0;
+    int32_t deltaReferenceHeight = 0;
+    bool isDeltaReferenceValid = false;
+    bool isEncodedKeyFrame = true;
+    const uint8_t* jpgScreenBuffer; // points into the last used encoder, valid until the next encode
     unsigned long jpgBufferSize;
     int jpgPix = 3; // jpg color components
     int redPos = 0;
@@ -123,9 +190,20 @@ protected:
 
     static std::chrono::system_clock::time_point startTime;
     static std::chrono::system_clock::time_point staticCardStartTime;
-    VirtualScreen::LoadDocType startLoadDoc = VirtualScreen::LoadDocType::INIT;
-    std::chrono::system_clock::time_point startDropFrameTime;   // record start drop frame time
-    int dropFrameFrequency = 0; // save drop frame frequency
+    std::atomic<VirtualScreen::LoadDocType> startLoadDoc {VirtualScreen::LoadDocType::INIT};
+    FramePacer framePacer;
+    static constexpr uint32_t keyFrameInterval = 100; // region frames between two full frames
+    uint32_t regionFrameCount = keyFrameInterval; // the first frame is always a full frame
+    uint32_t keyFrameConnectionCount = 0; // connection and key frame request count at the last key frame
+    std::atomic<uint64_t> lastFrameHash {0};
+    std::atomic<bool> isLastFrameHashValid {false};
+    bool isAdaptiveQuality = false;
+    QualityController qualityController;
+
+private:
+    uint32_t GetKeyFrameRequestCount() const;
+    void EncodeDelta(const uint8_t* data, const int32_t width, const int32_t height,
+                     JpegEncoder::InputFormat format, size_t stride, const EncodeRect& rect);
 };
 
 #endif // VIRTUALSCREEN_H
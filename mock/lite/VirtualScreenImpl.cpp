@@ -15,13 +15,12 @@
 
 #include "VirtualScreenImpl.h"
 
+#include <algorithm>
+
 #include "draw/draw_utils.h"
 #include "hal_tick.h"
 #include "image_decode_ability.h"
 
-#define boolean jpegboolean
-#include "jpeglib.h"
-#undef boolean
 #include "task_manager.h"
 #include "CommandParser.h"
 #include "ModelManager.h"
@@ -47,11 +46,15 @@ void VirtualScreenImpl::InitAll(std::string pipeName, std::string pipePort)
         return;
     }
 
+    // The engine renders at the original resolution, frames are scaled down to the compression resolution.
+    isScaled = GetScaledSize(orignalResolutionWidth, orignalResolutionHeight, scaledWidth, scaledHeight);
     bufferSize = orignalResolutionWidth * orignalResolutionHeight * pixelSize + headSize;
-    wholeBuffer = new uint8_t[LWS_PRE + bufferSize];
-    regionWholeBuffer = new uint8_t[LWS_PRE + bufferSize];
+    // Only the packet header is staged in screenBuffer, pixels are encoded straight from osBuffer.
+    wholeBuffer = new uint8_t[LWS_PRE + headSize];
+    regionBufferSize = headSize + GetMaxEncodedSize(orignalResolutionWidth, orignalResolutionHeight);
+    regionWholeBuffer = FrameBufferPool::GetInstance().Acquire(regionBufferSize);
     screenBuffer = wholeBuffer + LWS_PRE;
-    regionBuffer = regionWholeBuffer + LWS_PRE;
+    regionBuffer = regionWholeBuffer.get();
     osBuffer = new uint8_t[bufferSize];
     if (screenBuffer == nullptr) {
         ELOG("VirtualScreen::InitAll wholeBuffer memory allocation failed");
@@ -78,37 +81,93 @@ void VirtualScreenImpl::WriteRefreshRegion()
     WriteBuffer(protocolVersion);
     WriteBuffer(regionX1);
     WriteBuffer(regionY1);
-    regionWidth = static_cast<uint16_t>(orignalResolutionWidth);
     WriteBuffer(regionWidth);
-    regionHeight = static_cast<uint16_t>(orignalResolutionHeight);
     WriteBuffer(regionHeight);
+    while (currentPos < headCodecPos) {
+        WriteBuffer(static_cast<uint8_t>(0));
+    }
+    WriteBuffer(static_cast<uint16_t>(frameCodec));
 }
 
 void VirtualScreenImpl::UpdateRegion(int32_t x1, int32_t y1, int32_t x2, int32_t y2)
 {
     regionX1 = x1;
     regionY1 = y1;
-    regionX2 = (x2 < compressionResolutionWidth - extendPix)
-                   ? (x2 + extendPix) : (compressionResolutionWidth - 1);
-    regionY2 = (y2 < compressionResolutionHeight - extendPix)
-                   ? (y2 + extendPix) : (compressionResolutionHeight - 1);
+    regionX2 = (x2 < scaledWidth - extendPix) ? (x2 + extendPix) : (scaledWidth - 1);
+    regionY2 = (y2 < scaledHeight - extendPix) ? (y2 + extendPix) : (scaledHeight - 1);
     regionWidth = regionX2 - regionX1 + 1;
     regionHeight = regionY2 - regionY1 + 1;
 }
 
+void VirtualScreenImpl::AddDirtyRect(const OHOS::Rect& flushRect)
+{
+    int32_t x1 = std::max<int32_t>(flushRect.GetLeft(), 0);
+    int32_t y1 = std::max<int32_t>(flushRect.GetTop(), 0);
+    int32_t x2 = std::min<int32_t>(flushRect.GetRight(), orignalResolutionWidth - 1);
+    int32_t y2 = std::min<int32_t>(flushRect.GetBottom(), orignalResolutionHeight - 1);
+    if (x1 > x2 || y1 > y2) {
+        return;
+    }
+    if (!isChanged) {
+        dirtyX1 = x1;
+        dirtyY1 = y1;
+        dirtyX2 = x2;
+        dirtyY2 = y2;
+        dirtyTime = PerfStats::Clock::now();
+        isChanged = true;
+        return;
+    }
+    dirtyX1 = std::min(dirtyX1, x1);
+    dirtyY1 = std::min(dirtyY1, y1);
+    dirtyX2 = std::max(dirtyX2, x2);
+    dirtyY2 = std::max(dirtyY2, y2);
+}
+
+// Maps a rect of osBuffer into the scaled frame, one more pixel on every side covers the filter footprint.
+void VirtualScreenImpl::ScaleRect(int32_t& x1, int32_t& y1, int32_t& x2, int32_t& y2) const
+{
+    if (!isScaled) {
+        return;
+    }
+    int64_t left = static_cast<int64_t>(x1) * scaledWidth / orignalResolutionWidth - 1;
+    int64_t top = static_cast<int64_t>(y1) * scaledHeight / orignalResolutionHeight - 1;
+    int64_t right = static_cast<int64_t>(x2 + 1) * scaledWidth / orignalResolutionWidth + 1;
+    int64_t bottom = static_cast<int64_t>(y2 + 1) * scaledHeight / orignalResolutionHeight + 1;
+    x1 = static_cast<int32_t>(std::max<int64_t>(left, 0));
+    y1 = static_cast<int32_t>(std::max<int64_t>(top, 0));
+    x2 = static_cast<int32_t>(std::min<int64_t>(right, scaledWidth - 1));
+    y2 = static_cast<int32_t>(std::min<int64_t>(bottom, scaledHeight - 1));
+}
+
+bool VirtualScreenImpl::UpdateSendBuffer()
+{
+    sendBuffer = osBuffer + headSize;
+    sendStride = GetOsBufferStride();
+    if (!isScaled) {
+        return true;
+    }
+    sendBuffer = frameScaler.Scale(sendBuffer, orignalResolutionWidth, orignalResolutionHeight, sendStride,
+                                   scaledWidth, scaledHeight);
+    sendStride = static_cast<size_t>(scaledWidth) * pixelSize;
+    return sendBuffer != nullptr;
+}
+
 void VirtualScreenImpl::InitBuffer()
 {
     currentPos = 0;
     WriteBuffer(headStart);
     WriteBuffer(orignalResolutionWidth);
     WriteBuffer(orignalResolutionHeight);
-    WriteBuffer(compressionResolutionWidth);
-    WriteBuffer(compressionResolutionHeight);
+    WriteBuffer(scaledWidth);
+    WriteBuffer(scaledHeight);
 }
 
 void VirtualScreenImpl::ScheduleBufferSend()
 {
-    if (!isChanged) {
+    // A client that connected or missed a region or delta frame gets the current frame again as a key frame,
+    // even if nothing was flushed since the last send.
+    bool isKeyFrameRequested = IsKeyFrameRequested();
+    if (!isChanged && !isKeyFrameRequested) {
         return;
     }
 
@@ -116,74 +175,97 @@ void VirtualScreenImpl::ScheduleBufferSend()
         ELOG("image socket is not ready");
         return;
     }
+    if (GetSendWaitTime().count() > 0) {
+        return; // keep collecting dirty rects until the next tick of the pacer
+    }
+    if (!isChanged) {
+        dirtyTime = PerfStats::Clock::now();
+    }
+    PerfStats::Clock::time_point convertStart = PerfStats::GetInstance().Record(PerfStats::Stage::QUEUE, dirtyTime);
+    if (!isKeyFrameRequested &&
+        IsRepeatedFrame(osBuffer + headSize, GetOsBufferStride() * orignalResolutionHeight,
+                        orignalResolutionWidth, orignalResolutionHeight)) {
+        isChanged = false;
+        return;
+    }
+    if (!UpdateSendBuffer()) {
+        isChanged = false;
+        return;
+    }
     isFrameUpdated = true;
-    if (CommandParser::GetInstance().IsRegionRefresh()) {
-        SendFullBuffer();
+    bool isRegionRefresh = CommandParser::GetInstance().IsRegionRefresh();
+    bool isKeyFrame = true;
+    if (isRegionRefresh || frameCodec == FrameCodec::DELTA) {
+        isKeyFrame = IsKeyFrameRequired();
+    }
+    bool isRegion = false;
+    if (isRegionRefresh && !isKeyFrame) {
+        ScaleRect(dirtyX1, dirtyY1, dirtyX2, dirtyY2);
+        UpdateRegion(dirtyX1, dirtyY1, dirtyX2, dirtyY2);
+        isKeyFrame = regionWidth == scaledWidth && regionHeight == scaledHeight;
+        isRegion = !isKeyFrame;
+    }
+    PerfStats::GetInstance().Record(PerfStats::Stage::CONVERT, convertStart);
+    if (isRegion) {
+        SendRegionBuffer();
     } else {
-        SendFullBuffer();
+        SendFullBuffer(isKeyFrame); // a delta frame when it is not a key frame
     }
+    UpdateKeyFrameState(isKeyFrame);
+    PerfStats::GetInstance().Record(PerfStats::Stage::TOTAL, dirtyTime);
     if (isFirstSend) {
         ILOG("Send first buffer finish");
         TraceTool::GetInstance().HandleTrace("Send first buffer finish");
         isFirstSend = false;
     }
-    
-    {
-        std::lock_guard<std::mutex> guard(WebSocketServer::GetInstance().mutex);
-        if (!WebSocketServer::GetInstance().firstImageBuffer) {
-            WebSocketServer::GetInstance().firstImageBuffer = new uint8_t[LWS_PRE + bufferSize];
-            WebSocketServer::GetInstance().firstImagebufferSize = headSize + jpgBufferSize;
-        }
-        std::copy(regionBuffer,
-                  regionBuffer + headSize + jpgBufferSize,
-                  WebSocketServer::GetInstance().firstImageBuffer + LWS_PRE);
-    }
 
     sendFrameCountPerMinute++;
     isChanged = false;
 }
 
-void VirtualScreenImpl::Send(unsigned char* data, int32_t width, int32_t height)
+void VirtualScreenImpl::Send(const uint8_t* data, int32_t width, int32_t height, size_t stride, bool isKeyFrame)
 {
     if (CommandParser::GetInstance().GetScreenMode() == CommandParser::ScreenMode::STATIC
         && VirtualScreen::isOutOfSeconds) {
         return;
     }
     // if websocket is config, use websocet, else use localsocket
-    VirtualScreen::RgbToJpg(data + headSize, width, height);
+    EncodeRect rect = {regionX1, regionY1, scaledWidth, scaledHeight, isKeyFrame};
+    VirtualScreen::EncodeFrame(data, width, height, JpegEncoder::InputFormat::BGRA, stride, rect);
+    WriteFrameCodec(regionBuffer);
     std::copy(jpgScreenBuffer, jpgScreenBuffer + jpgBufferSize, regionBuffer + headSize);
-    WebSocketServer::GetInstance().WriteData(regionBuffer, headSize + jpgBufferSize);
+    // The frame is handed over to the transport, the next one is written into a new buffer from the pool.
+    WriteFrame(std::make_shared<const SharedFrame>(std::move(regionWholeBuffer), headSize + jpgBufferSize),
+               IsEncodedKeyFrame());
+    regionWholeBuffer = FrameBufferPool::GetInstance().Acquire(regionBufferSize);
+    regionBuffer = regionWholeBuffer.get();
     FreeJpgMemory();
 }
 
-void VirtualScreenImpl::SendFullBuffer()
+void VirtualScreenImpl::SendFullBuffer(bool isKeyFrame)
 {
+    UpdateRegion(0, 0, scaledWidth - 1, scaledHeight - 1);
     WriteRefreshRegion();
     std::copy(screenBuffer, screenBuffer + headSize, regionBuffer);
-    Send(reinterpret_cast<unsigned char*>(screenBuffer),
-         compressionResolutionWidth,
-         compressionResolutionHeight);
+    Send(sendBuffer, scaledWidth, scaledHeight, sendStride, isKeyFrame);
 }
 
 void VirtualScreenImpl::SendRegionBuffer()
 {
     WriteRefreshRegion();
     std::copy(screenBuffer, screenBuffer + headSize, regionBuffer);
-    for (int i = regionY1; i <= regionY2; ++i) {
-        uint8_t* startPos = screenBuffer + (i * compressionResolutionWidth + regionX1) * jpgPix + headSize;
-        std::copy(startPos,
-                  startPos + regionWidth * jpgPix,
-                  regionBuffer + ((i - regionY1) * regionWidth) * jpgPix + headSize);
-    }
-    Send(reinterpret_cast<unsigned char*>(regionBuffer), regionWidth, regionHeight);
+    const uint8_t* startPos = sendBuffer + regionY1 * sendStride + regionX1 * pixelSize;
+    Send(startPos, regionWidth, regionHeight, sendStride, false);
+}
+
+size_t VirtualScreenImpl::GetOsBufferStride() const
+{
+    return static_cast<size_t>(orignalResolutionWidth) * pixelSize;
 }
 
 void VirtualScreenImpl::FreeJpgMemory()
 {
-    if (jpgScreenBuffer != nullptr) {
-        free(jpgScreenBuffer);
-        jpgScreenBuffer = NULL;
-    }
+    jpgScreenBuffer = nullptr;
 }
 
 VirtualScreenImpl& VirtualScreenImpl::GetInstance()
@@ -200,10 +282,12 @@ void VirtualScreenImpl::CheckBufferSend()
 
 VirtualScreenImpl::VirtualScreenImpl()
     : wholeBuffer(nullptr),
-      regionWholeBuffer(nullptr),
+      regionBufferSize(0),
       screenBuffer(nullptr),
       regionBuffer(nullptr),
       osBuffer(nullptr),
+      sendBuffer(nullptr),
+      sendStride(0),
       isChanged(false),
       currentPos(0),
       bufferSize(0),
@@ -215,6 +299,13 @@ VirtualScreenImpl::VirtualScreenImpl()
       regionY2(0),
       regionWidth(0),
       regionHeight(0),
+      dirtyX1(0),
+      dirtyY1(0),
+      dirtyX2(0),
+      dirtyY2(0),
+      isScaled(false),
+      scaledWidth(0),
+      scaledHeight(0),
       bufferInfo(nullptr)
 {
 }
@@ -227,14 +318,11 @@ VirtualScreenImpl::~VirtualScreenImpl()
         screenBuffer = nullptr;
     }
     FreeJpgMemory();
-    if (WebSocketServer::GetInstance().firstImageBuffer) {
-        delete [] WebSocketServer::GetInstance().firstImageBuffer;
-        WebSocketServer::GetInstance().firstImageBuffer = nullptr;
-    }
 }
 
 void VirtualScreenImpl::Flush(const OHOS::Rect& flushRect)
 {
+    PerfStats::Clock::time_point callbackStart = PerfStats::Clock::now();
     if (isFirstRender) {
         ILOG("Get first render buffer");
         TraceTool::GetInstance().HandleTrace("Get first render buffer");
@@ -246,26 +334,17 @@ void VirtualScreenImpl::Flush(const OHOS::Rect& flushRect)
         return;
     }
 
-    for (int i = 0; i <= compressionResolutionHeight - 1; ++i) {
-        for (int j = 0; j <= compressionResolutionWidth - 1; ++j) {
-            uint8_t* curPixel = screenBuffer + (i * compressionResolutionWidth + j) * jpgPix + headSize;
-            uint8_t* osPixel = osBuffer + (i * compressionResolutionWidth + j) * pixelSize + headSize;
-            *(curPixel + redPos) = *(osPixel + bluePos);
-            *(curPixel + greenPos) = *(osPixel + greenPos);
-            *(curPixel + bluePos) = *(osPixel + redPos);
-        }
-    }
-
     validFrameCountPerMinute++;
-    isChanged = true;
-    ScheduleBufferSend();
+    // Only collect the flushed area here, TimerTaskHandler sends once per task cycle through CheckBufferSend.
+    AddDirtyRect(flushRect);
+    PerfStats::GetInstance().Record(PerfStats::Stage::CALLBACK, callbackStart);
 }
 
 OHOS::BufferInfo* VirtualScreenImpl::GetFBBufferInfo()
 {
     if (bufferInfo == nullptr) {
         bufferInfo = new OHOS::BufferInfo;
-        bufferInfo->rect = {0, 0, compressionResolutionWidth - 1, compressionResolutionHeight - 1};
+        bufferInfo->rect = {0, 0, orignalResolutionWidth - 1, orignalResolutionHeight - 1};
         bufferInfo->mode = OHOS::ARGB8888;
         bufferInfo->color = 0x44;
         bufferInfo->phyAddr = bufferInfo->virAddr = osBuffer + headSize;
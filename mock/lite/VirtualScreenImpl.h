@@ -44,15 +44,21 @@ private:
     ~VirtualScreenImpl();
     bool IsRectValid(int32_t x1, int32_t y1, int32_t x2, int32_t y2) const;
     uint8_t* wholeBuffer;
-    uint8_t* regionWholeBuffer;
+    FrameBufferPool::Buffer regionWholeBuffer; // LWS_PRE headroom included, handed over with every frame
+    size_t regionBufferSize;
     uint8_t* screenBuffer;
     uint8_t* regionBuffer;
     uint8_t* osBuffer;
+    const uint8_t* sendBuffer; // osBuffer or the scaled frame, set by UpdateSendBuffer
+    size_t sendStride;
     bool isChanged;
     void ScheduleBufferSend();
-    void Send(unsigned char* data, int32_t width, int32_t height);
-    void SendFullBuffer();
+    void Send(const uint8_t* data, int32_t width, int32_t height, size_t stride, bool isKeyFrame);
+    void SendFullBuffer(bool isKeyFrame);
     void SendRegionBuffer();
+    size_t GetOsBufferStride() const;
+    bool UpdateSendBuffer();
+    void ScaleRect(int32_t& x1, int32_t& y1, int32_t& x2, int32_t& y2) const;
     void FreeJpgMemory();
 
     template <class T, class = typename std::enable_if<std::is_integral<T>::value>::type>
@@ -66,6 +72,7 @@ private:
 
     void WriteRefreshRegion();
     void UpdateRegion(int32_t x1, int32_t y1, int32_t x2, int32_t y2);
+    void AddDirtyRect(const OHOS::Rect& flushRect);
 
     unsigned long long currentPos;
     uint64_t bufferSize;
@@ -78,6 +85,16 @@ private:
     int16_t regionY2;
     int16_t regionWidth;
     int16_t regionHeight;
+    // Union of the rects flushed since the last send, valid while isChanged is set.
+    int32_t dirtyX1;
+    int32_t dirtyY1;
+    int32_t dirtyX2;
+    int32_t dirtyY2;
+    PerfStats::Clock::time_point dirtyTime; // when the first of these rects was flushed
+    // Size of the sent frames, the compression resolution if it is smaller than the original one.
+    bool isScaled;
+    int32_t scaledWidth;
+    int32_t scaledHeight;
     int32_t extendPix = 15;
     OHOS::BufferInfo* bufferInfo;
     static constexpr int SEND_IMG_DURATION_MS = 300;
@@ -15,9 +15,7 @@
 
 #include "VirtualScreenImpl.h"
 
-#define boolean jpegboolean
-#include "jpeglib.h"
-#undef boolean
+#include <algorithm>
 
 #include "CommandLineInterface.h"
 #include "CommandParser.h"
@@ -32,39 +30,60 @@ VirtualScreenImpl& VirtualScreenImpl::GetInstance()
     return virtualScreen;
 }
 
-void VirtualScreenImpl::StartTimer()
+void VirtualScreenImpl::LoadDocThreadLoop()
 {
-    while (true) {
-        auto endTime = std::chrono::system_clock::now();
-        int64_t timePassed = chrono::duration_cast<chrono::milliseconds>(endTime -
-                             VirtualScreenImpl::GetInstance().startTime).count();
-        if (timePassed >= SEND_IMG_DURATION_MS) {
-            GetInstance().SetLoadDocFlag(VirtualScreen::LoadDocType::NORMAL);
-            VirtualScreen::isStartCount = true;
-            {
-                std::lock_guard<std::mutex> guard(WebSocketServer::GetInstance().mutex);
-                if (GetInstance().loadDocCopyBuffer != nullptr) {
-                    delete [] GetInstance().loadDocCopyBuffer;
-                    GetInstance().loadDocCopyBuffer = nullptr;
-                }
-                GetInstance().loadDocCopyBuffer = new uint8_t[GetInstance().lengthTemp];
-                std::copy(GetInstance().loadDocTempBuffer,
-                          GetInstance().loadDocTempBuffer + GetInstance().lengthTemp,
-                          GetInstance().loadDocCopyBuffer);
-            }
-            VirtualScreenImpl::GetInstance().protocolVersion =
-                static_cast<uint16_t>(VirtualScreen::ProtocolVersion::LOADDOC);
-            GetInstance().bufferSize = GetInstance().lengthTemp + GetInstance().headSize;
-            GetInstance().wholeBuffer = new uint8_t[LWS_PRE + GetInstance().bufferSize];
-            GetInstance().screenBuffer = GetInstance().wholeBuffer + LWS_PRE;
-            GetInstance().SendPixmap(GetInstance().loadDocCopyBuffer,
-                                     GetInstance().lengthTemp,
-                                     GetInstance().widthTemp,
-                                     GetInstance().heightTemp);
-            ILOG("LoadDocFlag2:finished");
+    std::unique_lock<std::mutex> lock(loadDocMutex);
+    while (!isLoadDocStopped) {
+        if (!isLoadDocPending) {
+            loadDocCondition.wait(lock);
+            continue;
+        }
+        if (loadDocCondition.wait_until(lock, loadDocDeadline, [this]() { return isLoadDocStopped; })) {
+            break;
+        }
+        // Leaving FINISHED before the pending flag is cleared keeps LoadDocCallback from scheduling a second frame.
+        SetLoadDocFlag(VirtualScreen::LoadDocType::NORMAL);
+        isLoadDocPending = false;
+        lock.unlock();
+        SendLoadDocFrame();
+        lock.lock();
+    }
+}
+
+void VirtualScreenImpl::ScheduleLoadDocFrame()
+{
+    {
+        std::lock_guard<std::mutex> guard(loadDocMutex);
+        // Later frames only replace loadDocTempBuffer, the first one sets the deadline. A callback that saw
+        // FINISHED right before the frame was sent comes too late.
+        if (isLoadDocPending || GetLoadDocFlag() != VirtualScreen::LoadDocType::FINISHED) {
             return;
         }
+        isLoadDocPending = true;
+        loadDocDeadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(SEND_IMG_DURATION_MS);
     }
+    loadDocCondition.notify_one();
+}
+
+void VirtualScreenImpl::SendLoadDocFrame()
+{
+    FrameQueue::Frame frame;
+    {
+        std::lock_guard<std::mutex> guard(WebSocketServer::GetInstance().mutex);
+        if (loadDocTempBuffer == nullptr) {
+            return;
+        }
+        frame.data = FrameBufferPool::GetInstance().Acquire(lengthTemp);
+        std::copy(loadDocTempBuffer.get(), loadDocTempBuffer.get() + lengthTemp, frame.data.get());
+        frame.length = lengthTemp;
+        frame.width = widthTemp;
+        frame.height = heightTemp;
+        frame.isKeyFrame = true;
+        frame.protocolVersion = static_cast<uint16_t>(VirtualScreen::ProtocolVersion::LOADDOC);
+    }
+    ClearLastFrameHash(); // the next render frame must follow the load doc frame
+    EnqueueFrame(std::move(frame));
+    ILOG("LoadDocFlag2:finished");
 }
 
 bool VirtualScreenImpl::LoadDocCallback(const void* data,
@@ -75,26 +94,18 @@ bool VirtualScreenImpl::LoadDocCallback(const void* data,
     if (GetInstance().GetLoadDocFlag() == VirtualScreen::LoadDocType::FINISHED) {
         {
             std::lock_guard<std::mutex> guard(WebSocketServer::GetInstance().mutex);
-            if (GetInstance().loadDocTempBuffer != nullptr) {
-                delete [] GetInstance().loadDocTempBuffer;
-                GetInstance().loadDocTempBuffer = nullptr;
-            }
+            GetInstance().loadDocTempBuffer.reset();
             GetInstance().lengthTemp = length;
             GetInstance().widthTemp = width;
             GetInstance().heightTemp = height;
             if (length <= 0) {
                 return false;
             }
-            GetInstance().loadDocTempBuffer = new uint8_t[length];
-            uint8_t*  dataPtr = reinterpret_cast<uint8_t*>(const_cast<void*>(data));
-            std::copy(dataPtr, dataPtr + length, GetInstance().loadDocTempBuffer);
-        }
-        if (VirtualScreen::isStartCount) {
-            VirtualScreen::isStartCount = false;
-            VirtualScreen::startTime = std::chrono::system_clock::now();
-            thread timerThread(std::ref(VirtualScreenImpl::StartTimer));
-            timerThread.detach();
+            GetInstance().loadDocTempBuffer = FrameBufferPool::GetInstance().Acquire(length);
+            const uint8_t* dataPtr = static_cast<const uint8_t*>(data);
+            std::copy(dataPtr, dataPtr + length, GetInstance().loadDocTempBuffer.get());
         }
+        GetInstance().ScheduleLoadDocFrame();
         return false;
     }
     return true;
@@ -103,20 +114,13 @@ bool VirtualScreenImpl::LoadDocCallback(const void* data,
 bool VirtualScreenImpl::CallBack(const void* data, const size_t length,
                                  const int32_t width, const int32_t height)
 {
+    PerfStats::Clock::time_point callbackStart = PerfStats::Clock::now();
     if (VirtualScreenImpl::GetInstance().StopSendStaticCardImage(STOP_SEND_CARD_DURATION_MS)) {
         return false;
     }
     if (VirtualScreenImpl::GetInstance().GetLoadDocFlag() < VirtualScreen::LoadDocType::FINISHED) {
         return false;
     }
-    if (VirtualScreenImpl::GetInstance().JudgeAndDropFrame()) {
-        return false;
-    }
-    VirtualScreenImpl::GetInstance().SetOrignalWidth(width);
-    VirtualScreenImpl::GetInstance().SetOrignalHeight(height);
-    VirtualScreenImpl::GetInstance().SetCompressionWidth(width);
-    VirtualScreenImpl::GetInstance().SetCompressionHeight(height);
-
     bool staticRet = VirtualScreen::JudgeStaticImage(SEND_IMG_DURATION_MS);
     if (!staticRet) {
         return false;
@@ -126,11 +130,82 @@ bool VirtualScreenImpl::CallBack(const void* data, const size_t length,
         return false;
     }
 
-    GetInstance().bufferSize = length + GetInstance().headSize;
-    GetInstance().wholeBuffer = new uint8_t[LWS_PRE + GetInstance().bufferSize];
-    GetInstance().screenBuffer = GetInstance().wholeBuffer + LWS_PRE;
+    if (data == nullptr) {
+        ELOG("render callback data is null.");
+        invalidFrameCountPerMinute++;
+        return false;
+    }
+    const uint8_t* dataPtr = static_cast<const uint8_t*>(data);
+    if (GetInstance().IsRepeatedFrame(dataPtr, length, width, height)) {
+        return false;
+    }
+    // Only snapshot the frame here, conversion, encoding and sending run on the encode thread.
+    FrameQueue::Frame frame;
+    frame.data = FrameBufferPool::GetInstance().Acquire(length);
+    std::copy(dataPtr, dataPtr + length, frame.data.get());
+    frame.length = length;
+    frame.width = width;
+    frame.height = height;
+    frame.renderTime = callbackStart;
+    GetInstance().EnqueueFrame(std::move(frame));
+    PerfStats::GetInstance().Record(PerfStats::Stage::CALLBACK, callbackStart);
+    return true;
+}
+
+void VirtualScreenImpl::EnqueueFrame(FrameQueue::Frame&& frame)
+{
+    if (!frameQueue.Push(std::move(frame))) {
+        staleFrameCountPerMinute++;
+    }
+    uint32_t depth = static_cast<uint32_t>(frameQueue.GetDepth());
+    if (depth > frameQueueDepthPerMinute) {
+        frameQueueDepthPerMinute = depth;
+    }
+}
 
-    return GetInstance().SendPixmap(data, length, width, height);
+void VirtualScreenImpl::EncodeThreadLoop()
+{
+    FrameQueue::Frame frame;
+    size_t replacedCount = 0;
+    std::chrono::milliseconds waitTime(isSharedMemoryRing ? KEY_FRAME_CHECK_INTERVAL_MS : IDLE_WAIT_MS);
+    while (frameQueue.Pop(frame, waitTime)) {
+        if (frame.data == nullptr) {
+            // Nothing was rendered, a client that connected or missed a region or delta frame gets the
+            // current frame again.
+            if (lastSentFrame.data == nullptr || !IsKeyFrameRequested()) {
+                continue;
+            }
+            frame = std::move(lastSentFrame);
+            frame.isKeyFrame = true;
+            frame.renderTime = PerfStats::Clock::now();
+        }
+        // Wait for the next tick of the pacer, the newest frame rendered until then is the one sent.
+        if (!frameQueue.Wait(GetSendWaitTime()) || !frameQueue.PopLatest(frame, replacedCount)) {
+            break;
+        }
+        staleFrameCountPerMinute += static_cast<uint32_t>(replacedCount);
+        // Render frames carry no version and keep the one of the last load doc frame, a resent frame keeps its own.
+        if (frame.protocolVersion == 0) {
+            frame.protocolVersion = protocolVersion;
+        } else {
+            protocolVersion = frame.protocolVersion;
+        }
+        PerfStats::GetInstance().Record(PerfStats::Stage::QUEUE, frame.renderTime);
+        frameRenderTime = frame.renderTime;
+        bufferSize = std::max(frame.length, GetMaxEncodedSize(frame.width, frame.height)) + headSize;
+        wholeBuffer = FrameBufferPool::GetInstance().Acquire(bufferSize);
+        screenBuffer = wholeBuffer.get();
+        if (frame.isKeyFrame) {
+            dirtyRegionDetector.Reset();
+            isDeltaReferenceValid = false; // the delta codec sends it as a key frame
+        }
+        SendPixmap(frame.data.get(), frame.length, frame.width, frame.height, frame.protocolVersion);
+        if (HasDependentFrames()) {
+            lastSentFrame = std::move(frame);
+        }
+        frame.data.reset();
+    }
+    lastSentFrame.data.reset();
 }
 
 bool VirtualScreenImpl::PageCallBack(const std::string currentRouterPath)
@@ -162,37 +237,67 @@ void VirtualScreenImpl::FastPreviewCallBack(const std::string& jsonStr)
 void VirtualScreenImpl::InitAll(string pipeName, string pipePort)
 {
     VirtualScreen::InitPipe(pipeName, pipePort);
+    if (isWebSocketListening) {
+        WebSocketServer::GetInstance().SetKeyFrameRequestCallback([this]() { frameQueue.Wakeup(); });
+    }
+    if (encodeThread == nullptr) {
+        encodeThread = std::make_unique<std::thread>(&VirtualScreenImpl::EncodeThreadLoop, this);
+    }
+    if (loadDocThread == nullptr) {
+        loadDocThread = std::make_unique<std::thread>(&VirtualScreenImpl::LoadDocThreadLoop, this);
+    }
 }
 
 VirtualScreenImpl::VirtualScreenImpl()
     : isFirstSend(true),
       isFirstRender(true),
       writed(0),
-      wholeBuffer(nullptr),
       screenBuffer(nullptr),
       bufferSize(0),
-      currentPos(0)
+      currentPos(0),
+      frameQueue(FRAME_QUEUE_CAPACITY),
+      encodeThread(nullptr),
+      loadDocThread(nullptr),
+      isLoadDocPending(false),
+      isLoadDocStopped(false)
 {
 }
 
 VirtualScreenImpl::~VirtualScreenImpl()
 {
+    StopThreads();
     FreeJpgMemory();
-    if (WebSocketServer::GetInstance().firstImageBuffer) {
-        delete [] WebSocketServer::GetInstance().firstImageBuffer;
-        WebSocketServer::GetInstance().firstImageBuffer = nullptr;
+    loadDocTempBuffer.reset();
+}
+
+void VirtualScreenImpl::Stop()
+{
+    if (isWebSocketListening) {
+        WebSocketServer::GetInstance().SetKeyFrameRequestCallback(nullptr);
+    }
+    StopThreads();
+    ReleaseFrames();
+    ILOG("VirtualScreenImpl::Stop frame threads stopped");
+}
+
+void VirtualScreenImpl::StopThreads()
+{
+    {
+        std::lock_guard<std::mutex> guard(loadDocMutex);
+        isLoadDocStopped = true;
     }
-    if (VirtualScreenImpl::GetInstance().loadDocTempBuffer != nullptr) {
-        delete [] VirtualScreenImpl::GetInstance().loadDocTempBuffer;
-        VirtualScreenImpl::GetInstance().loadDocTempBuffer = nullptr;
+    loadDocCondition.notify_all();
+    if (loadDocThread != nullptr && loadDocThread->joinable()) {
+        loadDocThread->join();
     }
-    if (VirtualScreenImpl::GetInstance().loadDocCopyBuffer != nullptr) {
-        delete [] VirtualScreenImpl::GetInstance().loadDocCopyBuffer;
-        VirtualScreenImpl::GetInstance().loadDocCopyBuffer = nullptr;
+    frameQueue.Stop();
+    if (encodeThread != nullptr && encodeThread->joinable()) {
+        encodeThread->join();
     }
 }
 
-void VirtualScreenImpl::Send(const void* data, int32_t retWidth, int32_t retHeight)
+void VirtualScreenImpl::Send(const uint8_t* data, int32_t retWidth, int32_t retHeight, size_t stride,
+                             const EncodeRect& rect)
 {
     if (CommandParser::GetInstance().GetScreenMode() == CommandParser::ScreenMode::STATIC
         && VirtualScreen::isOutOfSeconds) {
@@ -202,39 +307,23 @@ void VirtualScreenImpl::Send(const void* data, int32_t retWidth, int32_t retHeig
     if (retWidth < 1 || retHeight < 1) {
         FLOG("VirtualScreenImpl::RgbToJpg the retWidth or height is invalid value");
     }
-    unsigned char* dataTemp = new unsigned char[retWidth * retHeight * jpgPix];
-    for (int i = 0; i < retHeight; i++) {
-        for (int j = 0; j < retWidth; j++) {
-            int input_base_pos = i * retWidth * pixelSize + j * pixelSize;
-            int now_base_pos = i * retWidth * jpgPix + j * jpgPix;
-            dataTemp[now_base_pos + redPos] = *((char*)data + input_base_pos + redPos);
-            dataTemp[now_base_pos + greenPos] = *((char*)data + input_base_pos + greenPos);
-            dataTemp[now_base_pos + bluePos] = *((char*)data + input_base_pos + bluePos);
-        }
-    }
-    VirtualScreen::RgbToJpg(dataTemp, retWidth, retHeight);
-    delete [] dataTemp;
+    VirtualScreen::EncodeFrame(data, retWidth, retHeight, JpegEncoder::InputFormat::RGBA, stride, rect);
     if (jpgBufferSize > bufferSize - headSize) {
         FLOG("VirtualScreenImpl::Send length must < %d", bufferSize - headSize);
     }
 
+    WriteFrameCodec(screenBuffer);
     std::copy(jpgScreenBuffer, jpgScreenBuffer + jpgBufferSize, screenBuffer + headSize);
-    writed = WebSocketServer::GetInstance().WriteData(screenBuffer, headSize + jpgBufferSize);
-    std::lock_guard<std::mutex> guard(WebSocketServer::GetInstance().mutex);
-    if (WebSocketServer::GetInstance().firstImageBuffer) {
-        delete [] WebSocketServer::GetInstance().firstImageBuffer;
-        WebSocketServer::GetInstance().firstImageBuffer = nullptr;
-    }
-    WebSocketServer::GetInstance().firstImageBuffer = new uint8_t[LWS_PRE + bufferSize];
-    WebSocketServer::GetInstance().firstImagebufferSize = headSize + jpgBufferSize;
-    std::copy(screenBuffer,
-              screenBuffer + headSize + jpgBufferSize,
-              WebSocketServer::GetInstance().firstImageBuffer + LWS_PRE);
+    // The frame is handed over to the transport, the encode thread acquires a new buffer for the next one.
+    writed = WriteFrame(std::make_shared<const SharedFrame>(std::move(wholeBuffer), headSize + jpgBufferSize),
+                        IsEncodedKeyFrame());
+    PerfStats::GetInstance().Record(PerfStats::Stage::TOTAL, frameRenderTime);
 
     FreeJpgMemory();
 }
 
-bool VirtualScreenImpl::SendPixmap(const void* data, size_t length, int32_t retWidth, int32_t retHeight)
+bool VirtualScreenImpl::SendPixmap(const void* data, size_t length, int32_t retWidth, int32_t retHeight,
+                                   uint16_t frameProtocolVersion)
 {
     if (data == nullptr) {
         ELOG("render callback data is null.");
@@ -253,24 +342,44 @@ bool VirtualScreenImpl::SendPixmap(const void* data, size_t length, int32_t retW
         isFirstRender = false;
     }
 
+    PerfStats::Clock::time_point convertStart = PerfStats::Clock::now();
+    const uint8_t* dataPtr = static_cast<const uint8_t*>(data);
+    int32_t scaledWidth = retWidth;
+    int32_t scaledHeight = retHeight;
+    if (GetScaledSize(retWidth, retHeight, scaledWidth, scaledHeight)) {
+        dataPtr = frameScaler.Scale(dataPtr, retWidth, retHeight, static_cast<size_t>(retWidth) * pixelSize,
+                                    scaledWidth, scaledHeight);
+        if (dataPtr == nullptr) {
+            invalidFrameCountPerMinute++;
+            return false;
+        }
+    }
+
+    DirtyRegionDetector::Region region = {0, 0, scaledWidth, scaledHeight};
+    if (CommandParser::GetInstance().IsRegionRefresh() &&
+        !GetDirtyRegion(dataPtr, scaledWidth, scaledHeight, region)) {
+        return true; // nothing changed since the last sent frame
+    }
+    PerfStats::GetInstance().Record(PerfStats::Stage::CONVERT, convertStart);
+
     isFrameUpdated = true;
     currentPos = 0;
 
     WriteBuffer(headStart);
     WriteBuffer(retWidth);
     WriteBuffer(retHeight);
-    WriteBuffer(retWidth);
-    WriteBuffer(retHeight);
+    WriteBuffer(scaledWidth);
+    WriteBuffer(scaledHeight);
     if (!CommandParser::GetInstance().IsRegionRefresh()) {
         for (size_t i = 0; i < headReservedSize / sizeof(int32_t); i++) {
             WriteBuffer(static_cast<uint32_t>(0));
         }
     } else {
-        uint16_t x1 = 0;
-        uint16_t y1 = 0;
-        uint16_t width = static_cast<uint16_t>(retWidth);
-        uint16_t height = static_cast<uint16_t>(retHeight);
-        WriteBuffer(protocolVersion);
+        uint16_t x1 = static_cast<uint16_t>(region.x);
+        uint16_t y1 = static_cast<uint16_t>(region.y);
+        uint16_t width = static_cast<uint16_t>(region.width);
+        uint16_t height = static_cast<uint16_t>(region.height);
+        WriteBuffer(frameProtocolVersion);
         WriteBuffer(x1);
         WriteBuffer(y1);
         WriteBuffer(width);
@@ -279,7 +388,16 @@ bool VirtualScreenImpl::SendPixmap(const void* data, size_t length, int32_t retW
             WriteBuffer(static_cast<uint16_t>(0));
         }
     }
-    Send(data, retWidth, retHeight);
+    currentPos = headCodecPos;
+    WriteBuffer(static_cast<uint16_t>(frameCodec));
+    size_t stride = static_cast<size_t>(scaledWidth) * pixelSize;
+    bool isFullFrame = region.width == scaledWidth && region.height == scaledHeight;
+    EncodeRect rect = {region.x, region.y, scaledWidth, scaledHeight, isFullFrame};
+    if (frameCodec == FrameCodec::DELTA && !CommandParser::GetInstance().IsRegionRefresh()) {
+        rect.isKeyFrame = IsKeyFrameRequired();
+        UpdateKeyFrameState(rect.isKeyFrame);
+    }
+    Send(dataPtr + region.y * stride + region.x * pixelSize, region.width, region.height, stride, rect);
     if (isFirstSend) {
         ILOG("Send first buffer finish");
         TraceTool::GetInstance().HandleTrace("Send first buffer finish");
@@ -291,20 +409,24 @@ bool VirtualScreenImpl::SendPixmap(const void* data, size_t length, int32_t retW
     return writed == length;
 }
 
-void VirtualScreenImpl::FreeJpgMemory()
+bool VirtualScreenImpl::GetDirtyRegion(const uint8_t* data, int32_t retWidth, int32_t retHeight,
+                                       DirtyRegionDetector::Region& region)
 {
-    if (wholeBuffer != nullptr) {
-        delete [] wholeBuffer;
-        wholeBuffer = nullptr;
-        screenBuffer = nullptr;
-    }
-    if (jpgScreenBuffer != nullptr) {
-        free(jpgScreenBuffer);
-        jpgScreenBuffer = NULL;
-        jpgBufferSize = 0;
+    if (IsKeyFrameRequired()) {
+        dirtyRegionDetector.Reset();
     }
-    if (VirtualScreenImpl::GetInstance().loadDocCopyBuffer != nullptr) {
-        delete [] VirtualScreenImpl::GetInstance().loadDocCopyBuffer;
-        VirtualScreenImpl::GetInstance().loadDocCopyBuffer = nullptr;
+    size_t stride = static_cast<size_t>(retWidth) * pixelSize;
+    if (!dirtyRegionDetector.Detect(data, retWidth, retHeight, stride, region)) {
+        return false;
     }
+    UpdateKeyFrameState(region.width == retWidth && region.height == retHeight);
+    return true;
+}
+
+void VirtualScreenImpl::FreeJpgMemory()
+{
+    wholeBuffer.reset();
+    screenBuffer = nullptr;
+    jpgScreenBuffer = nullptr;
+    jpgBufferSize = 0;
 }
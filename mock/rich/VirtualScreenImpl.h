@@ -16,6 +16,14 @@
 #ifndef VIRTUALSREENIMPL_H
 #define VIRTUALSREENIMPL_H
 
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "DirtyRegionDetector.h"
+#include "FrameQueue.h"
 #include "VirtualScreen.h"
 
 class VirtualScreenImpl : public VirtualScreen {
@@ -23,7 +31,6 @@ public:
     VirtualScreenImpl(const VirtualScreenImpl&) = delete;
     VirtualScreenImpl& operator=(const VirtualScreenImpl&) = delete;
     static VirtualScreenImpl& GetInstance();
-    static void StartTimer();
     static bool LoadDocCallback(const void* data, const size_t length,
                                 const int32_t width, const int32_t height);
     static bool CallBack(const void* data, const size_t length, const int32_t width, const int32_t height);
@@ -31,13 +38,25 @@ public:
     static bool LoadContentCallBack(const std::string currentRouterPath);
     static void FastPreviewCallBack(const std::string& jsonStr);
     void InitAll(std::string pipeName, std::string pipePort);
+    // Stops the encode and load document threads before main returns, they must not send frames while the
+    // transport singletons are destroyed.
+    void Stop();
 
 private:
     VirtualScreenImpl();
     ~VirtualScreenImpl();
-    void Send(const void* data, int32_t retWidth, int32_t retHeight);
-    bool SendPixmap(const void* data, size_t length, int32_t retWidth, int32_t retHeight);
+    void Send(const uint8_t* data, int32_t retWidth, int32_t retHeight, size_t stride, const EncodeRect& rect);
+    bool SendPixmap(const void* data, size_t length, int32_t retWidth, int32_t retHeight,
+                    uint16_t frameProtocolVersion);
+    bool GetDirtyRegion(const uint8_t* data, int32_t retWidth, int32_t retHeight,
+                        DirtyRegionDetector::Region& region);
     void FreeJpgMemory();
+    void EnqueueFrame(FrameQueue::Frame&& frame);
+    void EncodeThreadLoop();
+    void StopThreads();
+    void LoadDocThreadLoop();
+    void ScheduleLoadDocFrame();
+    void SendLoadDocFrame();
     template<class T, class = typename std::enable_if<std::is_integral<T>::value>::type>
     void WriteBuffer(const T data)
     {
@@ -50,15 +69,34 @@ private:
     bool isFirstSend;
     bool isFirstRender;
     size_t writed;
-    uint8_t* wholeBuffer;
+    FrameBufferPool::Buffer wholeBuffer;
     uint8_t* screenBuffer;
     uint64_t bufferSize;
     unsigned long long currentPos;
     static constexpr int SEND_IMG_DURATION_MS = 300;
     static constexpr int STOP_SEND_CARD_DURATION_MS = 10000;
+    static constexpr size_t FRAME_QUEUE_CAPACITY = 2;
+    // The shared memory ring has no attach notification, its attach count is polled while no frame arrives.
+    static constexpr int KEY_FRAME_CHECK_INTERVAL_MS = 100;
+    static constexpr int IDLE_WAIT_MS = 1000;
+
+    // Region refresh state, only used on encodeThread.
+    DirtyRegionDetector dirtyRegionDetector;
+    PerfStats::Clock::time_point frameRenderTime; // render time of the frame being sent on encodeThread
+
+    // Frames are snapshotted on the render thread and encoded and sent on encodeThread.
+    FrameQueue frameQueue;
+    std::unique_ptr<std::thread> encodeThread;
+    FrameQueue::Frame lastSentFrame; // sent again as a key frame when a client needs one, only on encodeThread
 
-    uint8_t* loadDocTempBuffer;
-    uint8_t* loadDocCopyBuffer;
+    // The last frame rendered during LoadDocument is sent once SEND_IMG_DURATION_MS passed after the first.
+    std::unique_ptr<std::thread> loadDocThread;
+    std::mutex loadDocMutex;
+    std::condition_variable loadDocCondition;
+    std::chrono::steady_clock::time_point loadDocDeadline;
+    bool isLoadDocPending;
+    bool isLoadDocStopped;
+    FrameBufferPool::Buffer loadDocTempBuffer;
     size_t lengthTemp;
     int32_t widthTemp;
     int32_t heightTemp;
@@ -0,0 +1,155 @@
+/*
+ * Copyright (c) 2023 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Benchmark of the command parsing in CommandLineInterface::ProcessCommandMessage and a check of its version
+// validator.
+//   command_parse_bench [messages]
+// The old path built a CharReader for every message and matched the version with a std::regex, the new one reuses
+// one CharReader and calls PublicMethods::IsValidVersion. Both parse the same MouseMove and PointEvent messages.
+// The validator must accept and reject the same versions as the old regex with its '.' escaped, the unescaped '.'
+// also took any other character as a separator. Exits with 1 if the validator differs.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <regex>
+#include <string>
+#include <vector>
+
+#include "PublicMethods.h"
+#include "json.h"
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+constexpr int DEFAULT_MESSAGE_COUNT = 10000; // the old path takes a few hundred microseconds per message
+const char* const OLD_VERSION_PATTERN = "(([0-9]|([1-9]([0-9]*))).){2}([0-9]|([1-9]([0-9]*)))";
+const char* const FIXED_VERSION_PATTERN = "(([0-9]|([1-9]([0-9]*)))\\.){2}([0-9]|([1-9]([0-9]*)))";
+
+const char* const MESSAGES[] = {
+    R"({"type":"action","command":"MouseMove","version":"1.0.1","args":{"x":365,"y":1024}})",
+    R"({"type":"action","command":"PointEvent","version":"1.0.1","args":{"x":365,"y":1024,"button":0,)"
+    R"("action":2,"sourceType":1,"sourceTool":1,"axisValues":[0,0,0,0,0,0,0,0,0,0,0,0]}})",
+};
+
+bool IsValidEnvelope(bool isParsed, const Json::Value& jsonData)
+{
+    return isParsed && jsonData.isObject() && jsonData.isMember("type") && jsonData.isMember("command") &&
+        jsonData.isMember("version");
+}
+
+// ProcessCommandMessage before the reader was reused.
+bool ParseOld(const std::string& message)
+{
+    Json::CharReaderBuilder builder;
+    std::unique_ptr<Json::CharReader> reader(builder.newCharReader());
+    Json::Value jsonData;
+    std::string errors;
+    bool isParsed = reader->parse(message.c_str(), message.c_str() + message.size(), &jsonData, &errors);
+    return IsValidEnvelope(isParsed, jsonData) &&
+        std::regex_match(jsonData["version"].asString(), std::regex(OLD_VERSION_PATTERN));
+}
+
+bool ParseNew(Json::CharReader& reader, const std::string& message)
+{
+    Json::Value jsonData;
+    std::string errors;
+    bool isParsed = reader.parse(message.c_str(), message.c_str() + message.size(), &jsonData, &errors);
+    return IsValidEnvelope(isParsed, jsonData) && PublicMethods::IsValidVersion(jsonData["version"].asString());
+}
+
+// Both paths must accept every message, a rejected one counts as failed.
+template<class Parse>
+double MeasureNsPerMessage(const std::string& message, int count, Parse parse, int& failedCount)
+{
+    int acceptedCount = 0;
+    auto start = Clock::now();
+    for (int i = 0; i < count; i++) {
+        acceptedCount += parse(message) ? 1 : 0;
+    }
+    double elapsedNs = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+    if (acceptedCount != count) {
+        std::printf("FAIL %d of %d messages rejected\n", count - acceptedCount, count);
+        failedCount++;
+    }
+    return elapsedNs / count;
+}
+
+// Every string of up to maxLength characters of alphabet, plus versions the generated ones cannot reach.
+std::vector<std::string> GetVersions()
+{
+    std::vector<std::string> versions = {"1.0.1", "10.20.30", "4294967296.0.0", "01.0.1", "1.00.1", "1.0.01",
+                                         "1.0.1.", ".1.0.1", " 1.0.1", "1.0.1 ", "1.0.1\n", "1..1", "+1.0.1",
+                                         "1.0.-1", std::string("1.0\0.1", 6)}; // 6: with the NUL
+    const std::string alphabet = "019.x";
+    const size_t maxLength = 7;
+    std::vector<std::string> current = {""};
+    for (size_t length = 0; length <= maxLength; length++) {
+        versions.insert(versions.end(), current.begin(), current.end());
+        std::vector<std::string> next;
+        for (const std::string& prefix : current) {
+            for (char c : alphabet) {
+                next.push_back(prefix + c);
+            }
+        }
+        current.swap(next);
+    }
+    return versions;
+}
+
+int CheckVersions()
+{
+    std::regex oldPattern(OLD_VERSION_PATTERN);
+    std::regex fixedPattern(FIXED_VERSION_PATTERN);
+    int failedCount = 0;
+    size_t separatorCount = 0;
+    std::vector<std::string> versions = GetVersions();
+    for (const std::string& version : versions) {
+        bool isValid = PublicMethods::IsValidVersion(version);
+        if (isValid != std::regex_match(version, fixedPattern)) {
+            std::printf("FAIL \"%s\" is %s\n", version.c_str(), isValid ? "accepted" : "rejected");
+            failedCount++;
+        } else if (isValid != std::regex_match(version, oldPattern)) {
+            separatorCount++; // e.g. 1x0x1, only the old pattern accepts it
+        }
+    }
+    std::printf("versions: %zu checked, %zu only accepted by the unescaped '.', %d failed\n", versions.size(),
+                separatorCount, failedCount);
+    return failedCount;
+}
+}
+
+int main(int argc, char* argv[])
+{
+    int count = argc > 1 ? std::max(std::atoi(argv[1]), 1) : DEFAULT_MESSAGE_COUNT;
+    int failedCount = CheckVersions();
+
+    Json::CharReaderBuilder builder;
+    std::unique_ptr<Json::CharReader> reader(builder.newCharReader());
+    for (const char* text : MESSAGES) {
+        std::string message = text;
+        Json::Value jsonData;
+        std::string errors;
+        reader->parse(message.c_str(), message.c_str() + message.size(), &jsonData, &errors);
+        double oldNs = MeasureNsPerMessage(message, count, ParseOld, failedCount);
+        double newNs = MeasureNsPerMessage(
+            message, count, [&reader](const std::string& data) { return ParseNew(*reader, data); }, failedCount);
+        std::printf("%-10s old: %8.0f ns new: %8.0f ns per message (%.1fx)\n", jsonData["command"].asCString(), oldNs,
+                    newNs, newNs > 0 ? oldNs / newNs : 0.0);
+    }
+    return failedCount == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,203 @@
+/*
+ * Copyright (c) 2023 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "LosslessDecoder.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+constexpr size_t LZ4_MIN_MATCH = 4;
+constexpr size_t LZ4_RUN_MASK = 15;
+constexpr uint8_t LZ4_MAX_LENGTH_BYTE = 255;
+constexpr int LZ4_TOKEN_SHIFT = 4;
+constexpr size_t LZ4_OFFSET_SIZE = 2;
+constexpr int BITS_PER_BYTE = 8;
+
+constexpr uint8_t QOI_OP_INDEX = 0x00;
+constexpr uint8_t QOI_OP_DIFF = 0x40;
+constexpr uint8_t QOI_OP_LUMA = 0x80;
+constexpr uint8_t QOI_OP_RGB = 0xfe;
+constexpr uint8_t QOI_OP_RGBA = 0xff;
+constexpr uint8_t QOI_OP_MASK = 0xc0;
+constexpr uint8_t QOI_ARGUMENT_MASK = 0x3f;
+constexpr uint8_t QOI_CHANNELS = 4;
+constexpr size_t QOI_HEADER_SIZE = 14;
+constexpr size_t QOI_SIZE_POS = 4;
+constexpr size_t QOI_CHANNELS_POS = 12;
+constexpr size_t QOI_INDEX_SIZE = 64;
+constexpr uint8_t QOI_PADDING[] = {0, 0, 0, 0, 0, 0, 0, 1};
+constexpr uint8_t OPAQUE = 255;
+constexpr int RGBA_PIX = 4;
+
+struct Pixel {
+    uint8_t r;
+    uint8_t g;
+    uint8_t b;
+    uint8_t a;
+};
+
+uint32_t ReadBigEndian32(const uint8_t* data)
+{
+    uint32_t value = 0;
+    for (size_t i = 0; i < sizeof(value); i++) {
+        value = (value << BITS_PER_BYTE) | data[i];
+    }
+    return value;
+}
+}
+
+bool LosslessDecoder::ReadLz4Length(const uint8_t* src, size_t srcSize, size_t& pos, size_t& length)
+{
+    if (length != LZ4_RUN_MASK) {
+        return true;
+    }
+    uint8_t value = 0;
+    do {
+        if (pos >= srcSize) {
+            return false;
+        }
+        value = src[pos++];
+        length += value;
+    } while (value == LZ4_MAX_LENGTH_BYTE);
+    return true;
+}
+
+bool LosslessDecoder::DecodeLz4(const uint8_t* src, size_t srcSize, uint8_t* dst, size_t dstSize)
+{
+    if (src == nullptr || (dst == nullptr && dstSize > 0)) {
+        return false;
+    }
+    size_t ip = 0;
+    size_t op = 0;
+    while (ip < srcSize) {
+        uint8_t token = src[ip++];
+        size_t literalLength = token >> LZ4_TOKEN_SHIFT;
+        if (!ReadLz4Length(src, srcSize, ip, literalLength) || literalLength > srcSize - ip ||
+            literalLength > dstSize - op) {
+            return false;
+        }
+        std::copy_n(src + ip, literalLength, dst + op);
+        ip += literalLength;
+        op += literalLength;
+        if (ip == srcSize) {
+            break; // the last sequence has no match
+        }
+        if (srcSize - ip < LZ4_OFFSET_SIZE) {
+            return false;
+        }
+        size_t offset = src[ip] | static_cast<size_t>(src[ip + 1]) << BITS_PER_BYTE;
+        ip += LZ4_OFFSET_SIZE;
+        size_t matchLength = token & LZ4_RUN_MASK;
+        if (offset == 0 || offset > op || !ReadLz4Length(src, srcSize, ip, matchLength)) {
+            return false;
+        }
+        matchLength += LZ4_MIN_MATCH;
+        if (matchLength > dstSize - op) {
+            return false;
+        }
+        // Byte by byte, a match may overlap the bytes it produces.
+        for (size_t i = 0; i < matchLength; i++) {
+            dst[op + i] = dst[op + i - offset];
+        }
+        op += matchLength;
+    }
+    return op == dstSize;
+}
+
+bool LosslessDecoder::DecodeQoi(const uint8_t* src, size_t srcSize, std::vector<uint8_t>& rgba, int32_t& width,
+                                int32_t& height)
+{
+    if (src == nullptr || srcSize < QOI_HEADER_SIZE + sizeof(QOI_PADDING) || std::memcmp(src, "qoif", 4) != 0 ||
+        src[QOI_CHANNELS_POS] != QOI_CHANNELS) {
+        return false;
+    }
+    uint32_t imageWidth = ReadBigEndian32(src + QOI_SIZE_POS);
+    uint32_t imageHeight = ReadBigEndian32(src + QOI_SIZE_POS + sizeof(uint32_t));
+    size_t end = srcSize - sizeof(QOI_PADDING);
+    // Every chunk is at least one byte and encodes at most 62 pixels.
+    const size_t maxRun = 62;
+    size_t pixelCount = static_cast<size_t>(imageWidth) * imageHeight;
+    if (imageWidth == 0 || imageHeight == 0 || pixelCount / maxRun > end - QOI_HEADER_SIZE) {
+        return false;
+    }
+    rgba.resize(pixelCount * RGBA_PIX);
+    Pixel index[QOI_INDEX_SIZE] = {};
+    Pixel pixel = {0, 0, 0, OPAQUE};
+    size_t ip = QOI_HEADER_SIZE;
+    size_t run = 0;
+    for (size_t i = 0; i < pixelCount; i++) {
+        if (run > 0) {
+            run--;
+        } else {
+            if (ip >= end) {
+                return false;
+            }
+            uint8_t op = src[ip++];
+            // Ranges and biases below are fixed by the QOI specification.
+            if (op == QOI_OP_RGB || op == QOI_OP_RGBA) {
+                size_t channels = op == QOI_OP_RGB ? 3 : 4; // 3: rgb, 4: rgba
+                if (end - ip < channels) {
+                    return false;
+                }
+                pixel.r = src[ip++];
+                pixel.g = src[ip++];
+                pixel.b = src[ip++];
+                if (op == QOI_OP_RGBA) {
+                    pixel.a = src[ip++];
+                }
+            } else if ((op & QOI_OP_MASK) == QOI_OP_INDEX) {
+                pixel = index[op];
+            } else if ((op & QOI_OP_MASK) == QOI_OP_DIFF) {
+                pixel.r += ((op >> 4) & 3) - 2; // 4: red shift, 3: 2 bit mask, 2: diff bias
+                pixel.g += ((op >> 2) & 3) - 2; // 2: green shift
+                pixel.b += (op & 3) - 2;
+            } else if ((op & QOI_OP_MASK) == QOI_OP_LUMA) {
+                if (ip >= end) {
+                    return false;
+                }
+                uint8_t value = src[ip++];
+                int dg = (op & QOI_ARGUMENT_MASK) - 32; // 32: luma green bias
+                pixel.r += dg - 8 + ((value >> 4) & 0x0f); // 8: red bias, 4: red shift
+                pixel.g += dg;
+                pixel.b += dg - 8 + (value & 0x0f); // 8: blue bias
+            } else {
+                run = op & QOI_ARGUMENT_MASK; // QOI_OP_RUN, the stored length is one less than the run
+            }
+            // 3, 5, 7, 11: the QOI index hash
+            index[(pixel.r * 3 + pixel.g * 5 + pixel.b * 7 + pixel.a * 11) % QOI_INDEX_SIZE] = pixel;
+        }
+        std::memcpy(rgba.data() + i * RGBA_PIX, &pixel, sizeof(pixel));
+    }
+    width = static_cast<int32_t>(imageWidth);
+    height = static_cast<int32_t>(imageHeight);
+    return run == 0 && ip == end && std::equal(QOI_PADDING, QOI_PADDING + sizeof(QOI_PADDING), src + end);
+}
+
+bool LosslessDecoder::DecodeXorLz4(const uint8_t* src, size_t srcSize, std::vector<uint8_t>& reference,
+                                   bool isKeyFrame)
+{
+    if (isKeyFrame) {
+        return DecodeLz4(src, srcSize, reference.data(), reference.size());
+    }
+    std::vector<uint8_t> delta(reference.size());
+    if (!DecodeLz4(src, srcSize, delta.data(), delta.size())) {
+        return false;
+    }
+    for (size_t i = 0; i < reference.size(); i++) {
+        reference[i] ^= delta[i];
+    }
+    return true;
+}
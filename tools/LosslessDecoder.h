@@ -0,0 +1,40 @@
+/*
+ * Copyright (c) 2023 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LOSSLESSDECODER_H
+#define LOSSLESSDECODER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Minimal decoders of the LosslessEncoder output, the client side of the lz4, qoi and xor codecs. Every
+// decoder checks its input bounds and fails on malformed data instead of reading or writing past a buffer.
+class LosslessDecoder {
+public:
+    // Decodes one LZ4 block that must expand to exactly dstSize bytes.
+    static bool DecodeLz4(const uint8_t* src, size_t srcSize, uint8_t* dst, size_t dstSize);
+    // Decodes a QOI image into packed RGBA rows.
+    static bool DecodeQoi(const uint8_t* src, size_t srcSize, std::vector<uint8_t>& rgba, int32_t& width,
+                          int32_t& height);
+    // Decodes an xor frame on top of reference, the packed RGBA rows of the previous frame. reference is
+    // updated to the decoded frame. A key frame is decoded like lz4 and replaces reference.
+    static bool DecodeXorLz4(const uint8_t* src, size_t srcSize, std::vector<uint8_t>& reference, bool isKeyFrame);
+
+private:
+    static bool ReadLz4Length(const uint8_t* src, size_t srcSize, size_t& pos, size_t& length);
+};
+
+#endif // LOSSLESSDECODER_H
@@ -0,0 +1,221 @@
+/*
+ * Copyright (c) 2023 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Round trip check of LosslessEncoder: every frame is encoded with lz4, qoi and xor, decoded with
+// LosslessDecoder and compared with the packed RGBA rows of the input. Prints one line per case and exits
+// with 1 if any case failed.
+
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "LosslessDecoder.h"
+#include "LosslessEncoder.h"
+
+namespace {
+using InputFormat = JpegEncoder::InputFormat;
+
+constexpr int RGBA_PIX = 4;
+constexpr uint8_t OPAQUE = 255;
+constexpr uint32_t RANDOM_SEED = 20230601;
+
+enum class Content { SOLID, GRADIENT, NOISE };
+
+struct Frame {
+    int32_t width = 0;
+    int32_t height = 0;
+    InputFormat format = InputFormat::RGBA;
+    size_t stride = 0; // bytes per row including the padding at its end
+    std::vector<uint8_t> data;
+};
+
+size_t GetPixelSize(InputFormat format)
+{
+    return format == InputFormat::RGB ? 3 : 4; // 3: rgb, 4: rgba or bgra
+}
+
+// padding bytes are appended to every row and filled with garbage, the encoders must skip them.
+Frame MakeFrame(int32_t width, int32_t height, InputFormat format, size_t padding, Content content,
+                std::mt19937& random)
+{
+    Frame frame;
+    frame.width = width;
+    frame.height = height;
+    frame.format = format;
+    frame.stride = static_cast<size_t>(width) * GetPixelSize(format) + padding;
+    frame.data.resize(frame.stride * height);
+    for (size_t i = 0; i < frame.data.size(); i++) {
+        size_t x = i % frame.stride;
+        size_t y = i / frame.stride;
+        if (x >= static_cast<size_t>(width) * GetPixelSize(format) || content == Content::NOISE) {
+            frame.data[i] = static_cast<uint8_t>(random());
+        } else if (content == Content::GRADIENT) {
+            frame.data[i] = static_cast<uint8_t>(x + y * 3); // 3: a different slope per row
+        } else {
+            frame.data[i] = static_cast<uint8_t>(0x80 + x % GetPixelSize(format));
+        }
+    }
+    return frame;
+}
+
+std::vector<uint8_t> ToRgba(const Frame& frame)
+{
+    std::vector<uint8_t> rgba(static_cast<size_t>(frame.width) * frame.height * RGBA_PIX);
+    size_t pixelSize = GetPixelSize(frame.format);
+    for (int32_t y = 0; y < frame.height; y++) {
+        for (int32_t x = 0; x < frame.width; x++) {
+            const uint8_t* src = frame.data.data() + y * frame.stride + x * pixelSize;
+            uint8_t* dst = rgba.data() + (static_cast<size_t>(y) * frame.width + x) * RGBA_PIX;
+            bool isBgra = frame.format == InputFormat::BGRA;
+            dst[0] = isBgra ? src[2] : src[0]; // 2: blue of bgra
+            dst[1] = src[1];
+            dst[2] = isBgra ? src[0] : src[2]; // 2: blue
+            dst[3] = frame.format == InputFormat::RGB ? OPAQUE : src[3]; // 3: alpha
+        }
+    }
+    return rgba;
+}
+
+class RoundTrip {
+public:
+    void Check(const std::string& name, bool isPassed)
+    {
+        std::printf("%s %s\n", isPassed ? "PASS" : "FAIL", name.c_str());
+        failedCount += isPassed ? 0 : 1;
+    }
+
+    void CheckFrame(const std::string& name, const Frame& frame)
+    {
+        std::vector<uint8_t> expected = ToRgba(frame);
+        std::vector<uint8_t> decoded(expected.size());
+        bool isPassed = encoder.EncodeLz4(frame.data.data(), frame.width, frame.height, frame.format, frame.stride) &&
+            encoder.GetSize() <= LosslessEncoder::GetMaxSize(frame.width, frame.height) &&
+            LosslessDecoder::DecodeLz4(encoder.GetData(), encoder.GetSize(), decoded.data(), decoded.size()) &&
+            decoded == expected;
+        Check(name + " lz4", isPassed);
+
+        int32_t width = 0;
+        int32_t height = 0;
+        isPassed = encoder.EncodeQoi(frame.data.data(), frame.width, frame.height, frame.format, frame.stride) &&
+            encoder.GetSize() <= LosslessEncoder::GetMaxSize(frame.width, frame.height) &&
+            LosslessDecoder::DecodeQoi(encoder.GetData(), encoder.GetSize(), decoded, width, height) &&
+            width == frame.width && height == frame.height && decoded == expected;
+        Check(name + " qoi", isPassed);
+    }
+
+    // Encodes frames as a key frame followed by xor frames and decodes them on top of each other.
+    void CheckXorFrames(const std::string& name, const std::vector<Frame>& frames)
+    {
+        const Frame& first = frames.front();
+        size_t referenceStride = static_cast<size_t>(first.width) * RGBA_PIX;
+        std::vector<uint8_t> reference(referenceStride * first.height);
+        std::vector<uint8_t> decoded(reference.size());
+        bool isPassed = true;
+        for (size_t i = 0; i < frames.size() && isPassed; i++) {
+            const Frame& frame = frames[i];
+            bool isKeyFrame = i == 0;
+            isPassed = encoder.EncodeXorLz4(frame.data.data(), frame.width, frame.height, frame.format,
+                                            frame.stride, reference.data(), referenceStride, isKeyFrame) &&
+                LosslessDecoder::DecodeXorLz4(encoder.GetData(), encoder.GetSize(), decoded, isKeyFrame) &&
+                decoded == ToRgba(frame) && reference == decoded;
+        }
+        Check(name + " xor", isPassed);
+    }
+
+    void CheckMalformed()
+    {
+        std::vector<uint8_t> frame(64, 1); // 64: a compressible block
+        encoder.EncodeLz4(frame.data(), 4, 4, InputFormat::RGBA); // 4: a 4 x 4 frame
+        std::vector<uint8_t> block(encoder.GetData(), encoder.GetData() + encoder.GetSize());
+        std::vector<uint8_t> decoded(frame.size());
+        bool isRejected = true;
+        for (size_t size = 0; size < block.size(); size++) {
+            isRejected = isRejected && !LosslessDecoder::DecodeLz4(block.data(), size, decoded.data(), decoded.size());
+        }
+        isRejected = isRejected && !LosslessDecoder::DecodeLz4(block.data(), block.size(), decoded.data(),
+                                                               decoded.size() - 1);
+        Check("truncated lz4 rejected", isRejected);
+
+        encoder.EncodeQoi(frame.data(), 4, 4, InputFormat::RGBA);
+        block.assign(encoder.GetData(), encoder.GetData() + encoder.GetSize());
+        int32_t width = 0;
+        int32_t height = 0;
+        isRejected = true;
+        for (size_t size = 0; size < block.size(); size++) {
+            isRejected = isRejected && !LosslessDecoder::DecodeQoi(block.data(), size, decoded, width, height);
+        }
+        Check("truncated qoi rejected", isRejected);
+    }
+
+    int GetFailedCount() const
+    {
+        return failedCount;
+    }
+
+    LosslessEncoder encoder;
+
+private:
+    int failedCount = 0;
+};
+}
+
+int main()
+{
+    RoundTrip roundTrip;
+    std::mt19937 random(RANDOM_SEED);
+
+    uint8_t pixel[RGBA_PIX] = {};
+    roundTrip.Check("empty frame rejected",
+                    !roundTrip.encoder.EncodeLz4(pixel, 0, 0, InputFormat::RGBA) &&
+                    !roundTrip.encoder.EncodeQoi(pixel, 0, 0, InputFormat::RGBA) &&
+                    !roundTrip.encoder.EncodeLz4(nullptr, 1, 1, InputFormat::RGBA));
+    // A block of one token without literals is the LZ4 encoding of nothing.
+    const uint8_t emptyBlock[] = {0};
+    roundTrip.Check("empty lz4 block", LosslessDecoder::DecodeLz4(emptyBlock, sizeof(emptyBlock), pixel, 0) &&
+                    !LosslessDecoder::DecodeLz4(emptyBlock, 0, pixel, sizeof(pixel)) &&
+                    !LosslessDecoder::DecodeLz4(emptyBlock, sizeof(emptyBlock), pixel, sizeof(pixel)));
+
+    const InputFormat formats[] = {InputFormat::RGB, InputFormat::RGBA, InputFormat::BGRA};
+    const char* formatNames[] = {"rgb", "rgba", "bgra"};
+    for (size_t i = 0; i < sizeof(formats) / sizeof(formats[0]); i++) {
+        std::string format = formatNames[i];
+        roundTrip.CheckFrame("1x1 " + format, MakeFrame(1, 1, formats[i], 0, Content::NOISE, random));
+        // 7 x 5 pixels with 3 bytes of padding per row: odd width, odd stride and an unaligned row start.
+        roundTrip.CheckFrame("odd stride " + format, MakeFrame(7, 5, formats[i], 3, Content::GRADIENT, random));
+        roundTrip.CheckFrame("solid " + format, MakeFrame(333, 211, formats[i], 0, Content::SOLID, random));
+        roundTrip.CheckFrame("gradient " + format, MakeFrame(640, 120, formats[i], 0, Content::GRADIENT, random));
+        // Random pixels do not compress: lz4 writes literals only and qoi mostly rgba chunks, both near their bound.
+        roundTrip.CheckFrame("incompressible " + format, MakeFrame(257, 129, formats[i], 1, Content::NOISE, random));
+    }
+
+    std::vector<Frame> frames;
+    frames.push_back(MakeFrame(321, 97, InputFormat::BGRA, 4, Content::GRADIENT, random)); // 4: padding
+    frames.push_back(frames.back()); // unchanged, the delta is all zero
+    Frame changed = frames.back();
+    for (size_t i = 0; i < changed.data.size(); i += 97) { // 97: a few scattered pixels
+        changed.data[i] ^= 0x5a;
+    }
+    frames.push_back(changed);
+    frames.push_back(MakeFrame(321, 97, InputFormat::BGRA, 4, Content::NOISE, random));
+    roundTrip.CheckXorFrames("delta", frames);
+    roundTrip.CheckXorFrames("1x1", {MakeFrame(1, 1, InputFormat::RGB, 0, Content::NOISE, random),
+                                     MakeFrame(1, 1, InputFormat::RGB, 0, Content::NOISE, random)});
+
+    roundTrip.CheckMalformed();
+    std::printf("%d failed\n", roundTrip.GetFailedCount());
+    return roundTrip.GetFailedCount() == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,135 @@
+/*
+ * Copyright (c) 2023 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Check and benchmark of every PixelConverter variant the build and the cpu support.
+//   pixel_converter_bench [pixels] [rounds]
+// Every variant converts rgba and bgra buffers of odd sizes and unaligned starts and must produce the same bytes
+// as the scalar variant. Then each one converts the given number of pixels repeatedly and reports the source bytes
+// per cycle, cycles are read from the time stamp counter on x86 and are not available elsewhere.
+// Exits with 1 if any variant differed from the scalar output.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define PIXEL_CONVERTER_BENCH_TSC
+#endif
+
+#include "PixelConverter.h"
+
+namespace {
+using Clock = std::chrono::steady_clock;
+using Variant = PixelConverter::Variant;
+
+constexpr int RGBA_PIX = 4;
+constexpr int RGB_PIX = 3;
+constexpr size_t DEFAULT_PIXEL_COUNT = 1280 * 720;
+constexpr int DEFAULT_ROUNDS = 200;
+constexpr uint32_t RANDOM_SEED = 20230601;
+const Variant VARIANTS[] = {Variant::SCALAR, Variant::SSSE3, Variant::AVX2, Variant::NEON};
+
+uint64_t ReadCycles()
+{
+#ifdef PIXEL_CONVERTER_BENCH_TSC
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+// Compares the variant with the scalar output for every pixel count up to a few vector widths and every start
+// offset within a vector, so the tails and the unaligned loads are covered.
+bool CheckVariant(Variant variant, bool isBgra, const std::vector<uint8_t>& source)
+{
+    const size_t maxPixelCount = 97;
+    const size_t maxOffset = 32;
+    std::vector<uint8_t> expected(maxPixelCount * RGB_PIX + 1);
+    std::vector<uint8_t> converted(expected.size());
+    for (size_t offset = 0; offset < maxOffset; offset++) {
+        const uint8_t* src = source.data() + offset;
+        for (size_t pixelCount = 0; pixelCount <= maxPixelCount; pixelCount++) {
+            // The byte after the last pixel must be left alone.
+            std::fill(expected.begin(), expected.end(), 0xa5);
+            std::fill(converted.begin(), converted.end(), 0xa5);
+            PixelConverter::Convert(Variant::SCALAR, isBgra, src, expected.data(), pixelCount);
+            PixelConverter::Convert(variant, isBgra, src, converted.data(), pixelCount);
+            if (converted != expected) {
+                std::printf("FAIL %s %s %zu pixels at offset %zu\n", PixelConverter::GetVariantName(variant),
+                            isBgra ? "bgra" : "rgba", pixelCount, offset);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+void Benchmark(Variant variant, bool isBgra, const std::vector<uint8_t>& source, size_t pixelCount, int rounds)
+{
+    std::vector<uint8_t> converted(pixelCount * RGB_PIX);
+    PixelConverter::Convert(variant, isBgra, source.data(), converted.data(), pixelCount); // warm up
+    auto start = Clock::now();
+    uint64_t startCycles = ReadCycles();
+    for (int i = 0; i < rounds; i++) {
+        PixelConverter::Convert(variant, isBgra, source.data(), converted.data(), pixelCount);
+    }
+    uint64_t cycles = ReadCycles() - startCycles;
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    double bytes = static_cast<double>(pixelCount) * RGBA_PIX * rounds;
+    const double bytesPerGb = 1e9;
+    std::printf("%-6s %s %8.2f GB/s", PixelConverter::GetVariantName(variant), isBgra ? "bgra" : "rgba",
+                seconds > 0 ? bytes / seconds / bytesPerGb : 0.0);
+    if (cycles > 0) {
+        std::printf(" %6.2f bytes/cycle", bytes / cycles);
+    }
+    std::printf("\n");
+}
+}
+
+int main(int argc, char* argv[])
+{
+    const int decimal = 10;
+    size_t pixelCount = argc > 1 ? std::strtoull(argv[1], nullptr, decimal) : DEFAULT_PIXEL_COUNT;
+    int rounds = argc > 2 ? std::max(std::atoi(argv[2]), 1) : DEFAULT_ROUNDS;
+    pixelCount = std::max<size_t>(pixelCount, 1);
+
+    std::mt19937 random(RANDOM_SEED);
+    const size_t checkPixelCount = 128; // covers the largest count plus offset of CheckVariant
+    std::vector<uint8_t> source(std::max(pixelCount, checkPixelCount) * RGBA_PIX);
+    std::generate(source.begin(), source.end(), [&random]() { return static_cast<uint8_t>(random()); });
+
+    int failedCount = 0;
+    for (Variant variant : VARIANTS) {
+        std::vector<uint8_t> probe(RGB_PIX);
+        if (!PixelConverter::Convert(variant, false, source.data(), probe.data(), 1)) {
+            std::printf("%-6s not supported\n", PixelConverter::GetVariantName(variant));
+            continue;
+        }
+        for (bool isBgra : {false, true}) {
+            if (!CheckVariant(variant, isBgra, source)) {
+                failedCount++;
+                continue;
+            }
+            Benchmark(variant, isBgra, source, pixelCount, rounds);
+        }
+    }
+    std::printf("selected: %s, %d failed\n", PixelConverter::GetVariantName(PixelConverter::GetVariant()),
+                failedCount);
+    return failedCount == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,538 @@
+/*
+ * Copyright (c) 2023 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Reference consumer of the -shm frame transport (see SharedMemoryRing.h) and a throughput benchmark of it.
+//   shm_ring_consumer <name> [seconds]
+//       Reads the frames of a previewer started with -shm <name> and prints the frame rate once a second.
+//   shm_ring_consumer -bench [frame bytes] [seconds] [frames per second] [websocket port]
+//       Writes frames into a ring of its own on one thread and reads them back on another. Every frame carries
+//       its number and a fill pattern, a frame that passed the seqlock check but does not match is corrupt.
+//       With a port the same frames are then sent through WebSocketServer on 127.0.0.1 to a client of its own,
+//       at the same size and rate, so both transports are compared.
+//       Exits with 1 if a frame was corrupt, no frame arrived or the writer did not see the attach.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "FrameBufferPool.h"
+#include "SharedFrame.h"
+#include "SharedMemory.h"
+#include "SharedMemoryRing.h"
+#include "WebSocketServer.h"
+
+namespace {
+using Clock = std::chrono::steady_clock;
+using RingHeader = SharedMemoryRing::RingHeader;
+using SlotHeader = SharedMemoryRing::SlotHeader;
+
+class RingReader {
+public:
+    enum class Result { FRAME, TIMEOUT, FAILED };
+
+    struct Stats {
+        uint64_t frameCount = 0;
+        uint64_t byteCount = 0;
+        uint64_t missedCount = 0;    // frames the writer published while the reader was busy
+        uint64_t overtakenCount = 0; // reads the writer overtook, the seqlock check rejected them
+    };
+
+    // Step 1: waits for the ring, maps all slots and attaches.
+    bool Open(const std::string& name, std::chrono::milliseconds timeout)
+    {
+        auto deadline = Clock::now() + timeout;
+        const std::chrono::milliseconds retryPeriod(10);
+        while (!memory.Open(name, SharedMemoryRing::ringHeaderSize) || !IsReady()) {
+            if (Clock::now() >= deadline) {
+                std::fprintf(stderr, "ring %s is not ready\n", name.c_str());
+                return false;
+            }
+            std::this_thread::sleep_for(retryPeriod);
+        }
+        if (GetHeader()->version != SharedMemoryRing::RING_VERSION) {
+            std::fprintf(stderr, "ring version %u is not supported\n", GetHeader()->version);
+            return false;
+        }
+        slotCount = GetHeader()->slotCount;
+        slotStride = GetHeader()->slotStride;
+        slotSize = GetHeader()->slotSize;
+        if (!memory.Open(name, SharedMemoryRing::ringHeaderSize + slotStride * slotCount)) {
+            return false;
+        }
+        RequestKeyFrame();
+        return true;
+    }
+
+    // Asks the writer for a full frame, needed after region or delta frames were missed.
+    void RequestKeyFrame()
+    {
+        GetHeader()->attachCount.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // Steps 2 and 3: waits for a frame newer than the last one and copies it.
+    Result Read(std::vector<uint8_t>& frame, std::chrono::milliseconds timeout)
+    {
+        auto deadline = Clock::now() + timeout;
+        while (true) {
+            uint64_t index = GetHeader()->writeIndex.load(std::memory_order_acquire);
+            if (index == lastIndex) {
+                auto now = Clock::now();
+                if (now >= deadline ||
+                    !memory.Wait(std::chrono::duration_cast<std::chrono::milliseconds>(deadline - now))) {
+                    return Result::TIMEOUT;
+                }
+                continue;
+            }
+            const uint8_t* slot = memory.GetData() + SharedMemoryRing::ringHeaderSize +
+                static_cast<size_t>((index - 1) % slotCount) * slotStride;
+            const SlotHeader* slotHeader = reinterpret_cast<const SlotHeader*>(slot);
+            uint64_t sequence = index * 2;
+            if (slotHeader->sequence.load(std::memory_order_acquire) != sequence) {
+                stats.overtakenCount++;
+                continue;
+            }
+            uint64_t length = slotHeader->length;
+            if (length <= slotSize) {
+                frame.assign(slot + sizeof(SlotHeader), slot + sizeof(SlotHeader) + length);
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (slotHeader->sequence.load(std::memory_order_relaxed) != sequence || length > slotSize) {
+                stats.overtakenCount++;
+                continue;
+            }
+            if (lastIndex != 0) {
+                stats.missedCount += index - lastIndex - 1;
+            }
+            lastIndex = index;
+            stats.frameCount++;
+            stats.byteCount += length;
+            return Result::FRAME;
+        }
+    }
+
+    uint64_t GetIndex() const
+    {
+        return lastIndex;
+    }
+
+    const Stats& GetStats() const
+    {
+        return stats;
+    }
+
+private:
+    RingHeader* GetHeader() const
+    {
+        return reinterpret_cast<RingHeader*>(memory.GetData());
+    }
+
+    bool IsReady() const
+    {
+        return GetHeader()->magic.load(std::memory_order_acquire) == SharedMemoryRing::RING_MAGIC;
+    }
+
+    SharedMemory memory;
+    uint32_t slotCount = 0;
+    uint64_t slotStride = 0;
+    uint64_t slotSize = 0;
+    uint64_t lastIndex = 0;
+    Stats stats;
+};
+
+const std::chrono::milliseconds OPEN_TIMEOUT(5000);
+const std::chrono::milliseconds READ_TIMEOUT(1000);
+constexpr size_t DEFAULT_BENCH_FRAME_SIZE = 1280 * 720 * 4;
+constexpr int DEFAULT_SECONDS = 5;
+constexpr double BYTES_PER_MB = 1024.0 * 1024.0;
+
+// Client end of the websocket transport of the benchmark, every binary message is one frame. Runs the lws
+// service on the calling thread.
+class WebSocketReader {
+public:
+    WebSocketReader() = default;
+    WebSocketReader(const WebSocketReader&) = delete;
+    WebSocketReader& operator=(const WebSocketReader&) = delete;
+    ~WebSocketReader()
+    {
+        Close();
+    }
+
+    // Connects to the server on 127.0.0.1, retried until it listens or timeout passed.
+    bool Open(int port, std::chrono::milliseconds timeout)
+    {
+        protocols[0] = {"ws", WebSocketReader::Callback, 0, 0};
+        protocols[1] = {nullptr, nullptr, 0, 0};
+        struct lws_context_creation_info contextInfo = {};
+        contextInfo.port = CONTEXT_PORT_NO_LISTEN;
+        contextInfo.protocols = protocols;
+        contextInfo.user = this;
+        context = lws_create_context(&contextInfo);
+        if (context == nullptr) {
+            return false;
+        }
+        auto deadline = Clock::now() + timeout;
+        const std::chrono::milliseconds retryPeriod(10);
+        const int serviceTimeoutMs = 10;
+        while (!isConnected) {
+            if (Clock::now() >= deadline) {
+                std::fprintf(stderr, "websocket server on port %d is not ready\n", port);
+                return false;
+            }
+            if (wsi == nullptr) {
+                std::this_thread::sleep_for(retryPeriod);
+                Connect(port);
+            }
+            lws_service(context, serviceTimeoutMs);
+        }
+        return true;
+    }
+
+    // Services the connection until a frame arrived, the oldest one not read yet is returned.
+    RingReader::Result Read(std::vector<uint8_t>& frame, std::chrono::milliseconds timeout)
+    {
+        auto deadline = Clock::now() + timeout;
+        const int serviceTimeoutMs = 10;
+        while (frames.empty()) {
+            if (!isConnected) {
+                return RingReader::Result::FAILED;
+            }
+            if (Clock::now() >= deadline) {
+                return RingReader::Result::TIMEOUT;
+            }
+            lws_service(context, serviceTimeoutMs);
+        }
+        frame.swap(frames.front());
+        frames.pop_front();
+        return RingReader::Result::FRAME;
+    }
+
+    void Close()
+    {
+        if (context != nullptr) {
+            lws_context_destroy(context);
+            context = nullptr;
+        }
+        wsi = nullptr;
+        isConnected = false;
+    }
+
+private:
+    void Connect(int port)
+    {
+        struct lws_client_connect_info connectInfo = {};
+        connectInfo.context = context;
+        connectInfo.address = "127.0.0.1";
+        connectInfo.port = port;
+        connectInfo.path = "/";
+        connectInfo.host = connectInfo.address;
+        connectInfo.origin = connectInfo.address;
+        connectInfo.protocol = protocols[0].name;
+        connectInfo.pwsi = &wsi;
+        lws_client_connect_via_info(&connectInfo);
+    }
+
+    static int Callback(struct lws* wsi, enum lws_callback_reasons reason, void* user, void* in, size_t len)
+    {
+        WebSocketReader* reader =
+            wsi == nullptr ? nullptr : static_cast<WebSocketReader*>(lws_context_user(lws_get_context(wsi)));
+        if (reader == nullptr) {
+            return 0;
+        }
+        switch (reason) {
+            case LWS_CALLBACK_CLIENT_ESTABLISHED:
+                reader->isConnected = true;
+                break;
+            case LWS_CALLBACK_CLIENT_RECEIVE: {
+                // Large frames arrive in several parts, the last part of the last fragment completes the frame.
+                const uint8_t* data = static_cast<const uint8_t*>(in);
+                reader->message.insert(reader->message.end(), data, data + len);
+                if (lws_is_final_fragment(wsi) && lws_remaining_packet_payload(wsi) == 0) {
+                    reader->frames.emplace_back();
+                    reader->frames.back().swap(reader->message);
+                }
+                break;
+            }
+            case LWS_CALLBACK_CLIENT_CONNECTION_ERROR:
+            case LWS_CALLBACK_CLIENT_CLOSED:
+                reader->wsi = nullptr; // Open connects again, Read fails once it was connected
+                reader->isConnected = false;
+                reader->message.clear();
+                break;
+            default:
+                break;
+        }
+        return 0;
+    }
+
+    struct lws_protocols protocols[2] = {};
+    lws_context* context = nullptr;
+    lws* wsi = nullptr;
+    bool isConnected = false;
+    std::vector<uint8_t> message; // the parts of the frame being received
+    std::deque<std::vector<uint8_t>> frames; // frames received by one lws_service call, read in order
+};
+
+// The frame number and the write time lead every benchmark frame, the rest is filled with the low byte of the
+// frame number.
+struct BenchFrameHeader {
+    uint64_t index;
+    int64_t writeTimeNs;
+};
+
+int64_t GetNowNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch()).count();
+}
+
+void FillBenchFrame(uint8_t* data, size_t size, uint64_t index)
+{
+    std::fill(data + sizeof(BenchFrameHeader), data + size, static_cast<uint8_t>(index));
+    BenchFrameHeader header = {index, GetNowNs()};
+    std::memcpy(data, &header, sizeof(header));
+}
+
+// Checks the frames of one benchmark run as they arrive and collects what both transports report.
+class BenchChecker {
+public:
+    explicit BenchChecker(size_t size) : frameSize(size) {}
+
+    // expectedIndex is the frame number the transport itself reported, 0 if it has none.
+    void Check(const std::vector<uint8_t>& frame, uint64_t expectedIndex)
+    {
+        int64_t now = GetNowNs();
+        BenchFrameHeader header = {};
+        if (frame.size() >= sizeof(header)) {
+            std::memcpy(&header, frame.data(), sizeof(header));
+        }
+        uint8_t fill = static_cast<uint8_t>(header.index);
+        if (frame.size() != frameSize || header.index <= lastIndex ||
+            (expectedIndex != 0 && header.index != expectedIndex) ||
+            std::any_of(frame.begin() + sizeof(header), frame.end(), [fill](uint8_t v) { return v != fill; })) {
+            corruptCount++;
+            return;
+        }
+        if (lastIndex != 0) {
+            missedCount += header.index - lastIndex - 1;
+        }
+        lastIndex = header.index;
+        frameCount++;
+        latencyNs += now - header.writeTimeNs;
+        maxLatencyNs = std::max(maxLatencyNs, now - header.writeTimeNs);
+    }
+
+    void Print(const char* transport, uint64_t writtenCount, double seconds) const
+    {
+        const double nsPerUs = 1000.0;
+        std::printf("%-9s written: %llu (%.1f/s) received: %llu (%.1f/s) %.1f MB/s missed: %llu\n", transport,
+                    static_cast<unsigned long long>(writtenCount), writtenCount / seconds,
+                    static_cast<unsigned long long>(frameCount), frameCount / seconds,
+                    frameCount * static_cast<double>(frameSize) / BYTES_PER_MB / seconds,
+                    static_cast<unsigned long long>(missedCount));
+        std::printf("%-9s latency: %.1f us average %.1f us max corrupt: %llu\n", transport,
+                    frameCount > 0 ? latencyNs / nsPerUs / frameCount : 0.0, maxLatencyNs / nsPerUs,
+                    static_cast<unsigned long long>(corruptCount));
+    }
+
+    bool IsPassed() const
+    {
+        return corruptCount == 0 && frameCount > 0;
+    }
+
+private:
+    size_t frameSize;
+    uint64_t lastIndex = 0;
+    uint64_t frameCount = 0;
+    uint64_t missedCount = 0;
+    uint64_t corruptCount = 0;
+    int64_t latencyNs = 0;
+    int64_t maxLatencyNs = 0;
+};
+
+// Calls write with frame numbers 1, 2, ... at framesPerSecond, or as fast as possible if it is 0, until isRunning
+// is cleared or write fails.
+template<class Write>
+std::thread StartBenchWriter(int framesPerSecond, const std::atomic<bool>& isRunning,
+                             std::atomic<uint64_t>& writtenCount, Write write)
+{
+    return std::thread([framesPerSecond, &isRunning, &writtenCount, write]() {
+        auto period = framesPerSecond > 0 ? std::chrono::nanoseconds(std::chrono::seconds(1)) / framesPerSecond :
+            std::chrono::nanoseconds(0);
+        auto nextWrite = Clock::now();
+        for (uint64_t index = 1; isRunning; index++) {
+            if (!write(index)) {
+                break;
+            }
+            writtenCount = index;
+            if (period.count() > 0) {
+                nextWrite += period;
+                std::this_thread::sleep_until(nextWrite);
+            }
+        }
+    });
+}
+
+void PrintStats(const RingReader::Stats& stats, double seconds)
+{
+    std::printf("frames: %llu (%.1f/s) %.1f MB/s missed: %llu overtaken: %llu\n",
+                static_cast<unsigned long long>(stats.frameCount), stats.frameCount / seconds,
+                stats.byteCount / BYTES_PER_MB / seconds, static_cast<unsigned long long>(stats.missedCount),
+                static_cast<unsigned long long>(stats.overtakenCount));
+}
+
+int RunConsumer(const std::string& name, int seconds)
+{
+    RingReader reader;
+    if (!reader.Open(name, OPEN_TIMEOUT)) {
+        return EXIT_FAILURE;
+    }
+    std::vector<uint8_t> frame;
+    auto start = Clock::now();
+    auto end = start + std::chrono::seconds(seconds);
+    auto nextPrint = start + std::chrono::seconds(1);
+    while (Clock::now() < end) {
+        uint64_t missedCount = reader.GetStats().missedCount;
+        if (reader.Read(frame, READ_TIMEOUT) == RingReader::Result::FRAME &&
+            reader.GetStats().missedCount != missedCount) {
+            // This consumer does not tell region and delta frames apart, it asks for a full frame after any gap.
+            reader.RequestKeyFrame();
+        }
+        if (Clock::now() >= nextPrint) {
+            PrintStats(reader.GetStats(), std::chrono::duration<double>(Clock::now() - start).count());
+            nextPrint += std::chrono::seconds(1);
+        }
+    }
+    return EXIT_SUCCESS;
+}
+
+bool RunRingBenchmark(size_t frameSize, int seconds, int framesPerSecond)
+{
+    std::string name = "previewer_ring_bench_" + std::to_string(GetNowNs());
+    SharedMemoryRing& ring = SharedMemoryRing::GetInstance();
+    if (!ring.Open(name, frameSize)) {
+        return false;
+    }
+    std::atomic<bool> isRunning(true);
+    std::atomic<uint64_t> writtenCount(0);
+    std::vector<uint8_t> source(frameSize);
+    std::thread writer = StartBenchWriter(framesPerSecond, isRunning, writtenCount, [&ring, &source](uint64_t index) {
+        FillBenchFrame(source.data(), source.size(), index);
+        return ring.WriteData(source.data(), source.size()) == source.size();
+    });
+
+    RingReader reader;
+    bool isOpened = reader.Open(name, OPEN_TIMEOUT);
+    BenchChecker checker(frameSize);
+    auto start = Clock::now();
+    std::vector<uint8_t> frame;
+    while (isOpened && Clock::now() - start < std::chrono::seconds(seconds)) {
+        if (reader.Read(frame, READ_TIMEOUT) == RingReader::Result::FRAME) {
+            checker.Check(frame, reader.GetIndex());
+        }
+    }
+    double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+    isRunning = false;
+    writer.join();
+    uint32_t attachCount = ring.GetAttachCount();
+    ring.Close();
+
+    std::printf("frame size: %zu bytes\n", frameSize);
+    checker.Print("ring", writtenCount, elapsed);
+    std::printf("ring      overtaken: %llu attach count: %u\n",
+                static_cast<unsigned long long>(reader.GetStats().overtakenCount), attachCount);
+    return isOpened && checker.IsPassed() && attachCount > 0;
+}
+
+// The same frames through WebSocketServer to a client on 127.0.0.1, as the previewer sends them without -shm.
+// Every frame is a key frame, a client that does not keep up skips frames like a ring reader does.
+bool RunWebSocketBenchmark(size_t frameSize, int seconds, int framesPerSecond, int port)
+{
+    WebSocketServer& server = WebSocketServer::GetInstance();
+    server.SetServerPort(port);
+    server.Run();
+    WebSocketReader reader;
+    if (!reader.Open(port, OPEN_TIMEOUT)) {
+        return false;
+    }
+
+    std::atomic<bool> isRunning(true);
+    std::atomic<uint64_t> writtenCount(0);
+    auto write = [&server, frameSize](uint64_t index) {
+        FrameBufferPool::Buffer buffer = FrameBufferPool::GetInstance().Acquire(frameSize);
+        FillBenchFrame(buffer.get(), frameSize, index);
+        server.WriteData(std::make_shared<const SharedFrame>(std::move(buffer), frameSize), true);
+        return true;
+    };
+    std::thread writer = StartBenchWriter(framesPerSecond, isRunning, writtenCount, write);
+
+    BenchChecker checker(frameSize);
+    bool isConnected = true;
+    auto start = Clock::now();
+    std::vector<uint8_t> frame;
+    while (isConnected && Clock::now() - start < std::chrono::seconds(seconds)) {
+        RingReader::Result result = reader.Read(frame, READ_TIMEOUT);
+        if (result == RingReader::Result::FRAME) {
+            checker.Check(frame, 0);
+        }
+        isConnected = result != RingReader::Result::FAILED;
+    }
+    double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+    isRunning = false;
+    writer.join();
+    reader.Close();
+    // The service thread keeps running until exit, the queued frames go back to the pool before it is destroyed.
+    server.ReleaseFrames();
+
+    checker.Print("websocket", writtenCount, elapsed);
+    return isConnected && checker.IsPassed();
+}
+
+int RunBenchmark(size_t frameSize, int seconds, int framesPerSecond, int port)
+{
+    frameSize = std::max(frameSize, sizeof(BenchFrameHeader));
+    bool isPassed = RunRingBenchmark(frameSize, seconds, framesPerSecond);
+    if (port > 0) {
+        isPassed = RunWebSocketBenchmark(frameSize, seconds, framesPerSecond, port) && isPassed;
+    }
+    return isPassed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2) {
+        std::printf("usage: %s <name> [seconds]\n"
+                    "       %s -bench [frame bytes] [seconds] [frames per second] [websocket port]\n", argv[0],
+                    argv[0]);
+        return EXIT_FAILURE;
+    }
+    std::string name = argv[1];
+    const int decimal = 10;
+    if (name == "-bench") {
+        size_t frameSize = argc > 2 ? std::strtoull(argv[2], nullptr, decimal) : DEFAULT_BENCH_FRAME_SIZE;
+        int seconds = argc > 3 ? std::atoi(argv[3]) : DEFAULT_SECONDS;
+        int framesPerSecond = argc > 4 ? std::atoi(argv[4]) : 0;
+        int port = argc > 5 ? std::atoi(argv[5]) : 0;
+        return RunBenchmark(frameSize, seconds, framesPerSecond, port);
+    }
+    return RunConsumer(name, argc > 2 ? std::atoi(argv[2]) : DEFAULT_SECONDS);
+}
@@ -46,7 +46,14 @@ CommandParser::CommandParser()
       containerSdkPath(""),
       isComponentMode(false),
       abilityPath(""),
-      staticCard(false)
+      staticCard(false),
+      jpegStripCount(1),
+      isAdaptiveQuality(false),
+      minJpgQuality(0),
+      maxJpgQuality(0),
+      minFrameRate(0),
+      frameCodec("jpeg"),
+      sharedMemoryName("")
 {
     Register("-j", 1, "Launch the js app in <directory>.");
     Register("-n", 1, "Set the js app name show on <window title>.");
@@ -70,6 +77,7 @@ CommandParser::CommandParser()
     Register("-cm", 1, "Set colormode for the theme.");
     Register("-o", 1, "Set orientation for the display.");
     Register("-lws", 1, "Listening port of WebSocket");
+    Register("-shm", 1, "Send frames through the shared memory ring <name> instead of the WebSocket");
     Register("-av", 1, "Set ace version.");
     Register("-l", 1, "Set language for startParam.");
     Register("-sd", 1, "Set screenDensity for Previewer.");
@@ -83,6 +91,10 @@ CommandParser::CommandParser()
     Register("-cpm", 1, "Set previewer start mode.");
     Register("-abp", 1, "Set abilityPath for debug.");
     Register("-staticCard", 1, "Set card mode.");
+    Register("-jpegStrips", 1, "Number of strips <count> encoded in parallel for large frames.");
+    Register("-adaptiveQuality", 3, "Adapt jpeg quality and frame rate to the load within "
+             "<min-quality> <max-quality> <min-fps>"); // 3 arguments
+    Register("-codec", 1, "Frame <codec>, support jpeg, raw, lz4, qoi and delta");
 }
 
 CommandParser& CommandParser::GetInstance()
@@ -121,6 +133,8 @@ bool CommandParser::IsCommandValid()
     partRet = partRet && IsScreenModeValid() && IsAppResourcePathValid();
     partRet = partRet && IsProjectModelValid() && IsPagesValid() && IsContainerSdkPathValid();
     partRet = partRet && IsComponentModeValid() && IsAbilityPathValid() && IsStaticCardValid();
+    partRet = partRet && IsJpegStripsValid() && IsAdaptiveQualityValid() && IsFrameCodecValid();
+    partRet = partRet && IsSharedMemoryNameValid();
     if (partRet) {
         return true;
     }
@@ -280,6 +294,46 @@ bool CommandParser::IsStaticCard() const
     return staticCard;
 }
 
+uint32_t CommandParser::GetJpegStripCount() const
+{
+    return jpegStripCount;
+}
+
+bool CommandParser::IsAdaptiveQuality() const
+{
+    return isAdaptiveQuality;
+}
+
+int CommandParser::GetMinJpgQuality() const
+{
+    return minJpgQuality;
+}
+
+int CommandParser::GetMaxJpgQuality() const
+{
+    return maxJpgQuality;
+}
+
+int CommandParser::GetMinFrameRate() const
+{
+    return minFrameRate;
+}
+
+string CommandParser::GetFrameCodec() const
+{
+    return frameCodec;
+}
+
+string CommandParser::GetSharedMemoryName() const
+{
+    return sharedMemoryName;
+}
+
+int32_t CommandParser::GetMaxResolution() const
+{
+    return MAX_RESOLUTION;
+}
+
 bool CommandParser::IsDebugPortValid()
 {
     if (IsSet("p")) {
@@ -850,6 +904,101 @@ bool CommandParser::IsStaticCardValid()
     return true;
 }
 
+bool CommandParser::IsJpegStripsValid()
+{
+    if (!IsSet("jpegStrips")) {
+        return true;
+    }
+    if (CheckParamInvalidity(Value("jpegStrips"), true)) {
+        errorInfo = "Launch -jpegStrips parameters is not match regex.";
+        return false;
+    }
+    int count = atoi(Value("jpegStrips").c_str());
+    if (count < MIN_JPEG_STRIPS || count > MAX_JPEG_STRIPS) {
+        errorInfo = string("Jpeg strip count out of range: " + to_string(MIN_JPEG_STRIPS) + "-" +
+                           to_string(MAX_JPEG_STRIPS) + ".");
+        ELOG("Launch -jpegStrips parameters abnormal!");
+        return false;
+    }
+    jpegStripCount = static_cast<uint32_t>(count);
+    ILOG("CommandParser jpeg strips: %d", jpegStripCount);
+    return true;
+}
+
+bool CommandParser::IsAdaptiveQualityValid()
+{
+    if (!IsSet("adaptiveQuality")) {
+        return true;
+    }
+    vector<string> values = Values("-adaptiveQuality");
+    if (values.size() != regsArgsCountMap["-adaptiveQuality"]) {
+        errorInfo = string("Invalid argument's count.");
+        return false;
+    }
+    for (const string& value : values) {
+        if (CheckParamInvalidity(value, true)) {
+            errorInfo = "Launch -adaptiveQuality parameters is not match regex.";
+            return false;
+        }
+    }
+    int minQuality = atoi(values[0].c_str());
+    int maxQuality = atoi(values[1].c_str());
+    int frameRate = atoi(values[2].c_str()); // 2: the third argument
+    if (minQuality < MIN_JPEG_QUALITY || maxQuality > MAX_JPEG_QUALITY || minQuality > maxQuality) {
+        errorInfo = string("Jpeg quality out of range: " + to_string(MIN_JPEG_QUALITY) + "-" +
+                           to_string(MAX_JPEG_QUALITY) + ".");
+        ELOG("Launch -adaptiveQuality parameters abnormal!");
+        return false;
+    }
+    if (frameRate < MIN_FRAME_RATE || frameRate > MAX_FRAME_RATE) {
+        errorInfo = string("Frame rate out of range: " + to_string(MIN_FRAME_RATE) + "-" +
+                           to_string(MAX_FRAME_RATE) + ".");
+        ELOG("Launch -adaptiveQuality parameters abnormal!");
+        return false;
+    }
+    isAdaptiveQuality = true;
+    minJpgQuality = minQuality;
+    maxJpgQuality = maxQuality;
+    minFrameRate = frameRate;
+    ILOG("CommandParser adaptive quality: %d-%d min fps: %d", minJpgQuality, maxJpgQuality, minFrameRate);
+    return true;
+}
+
+bool CommandParser::IsFrameCodecValid()
+{
+    if (!IsSet("codec")) {
+        return true;
+    }
+    string codec = Value("codec");
+    if (std::find(frameCodecs.begin(), frameCodecs.end(), codec) == frameCodecs.end()) {
+        errorInfo = string("The codec argument unsupported.");
+        ELOG("Launch -codec parameters abnormal!");
+        return false;
+    }
+    frameCodec = codec;
+    ILOG("CommandParser frame codec: %s", frameCodec.c_str());
+    return true;
+}
+
+bool CommandParser::IsSharedMemoryNameValid()
+{
+    if (!IsSet("shm")) {
+        return true;
+    }
+    string name = Value("shm");
+    // The name becomes a shared memory and a semaphore name, "/<name>.bell" has to fit the 31 bytes of macOS.
+    regex reg("^[a-zA-Z0-9_-]+$");
+    if (name.size() > MAX_SHM_NAME_LENGTH || !regex_match(name.cbegin(), name.cend(), reg)) {
+        errorInfo = string("The shared memory name is up to " + to_string(MAX_SHM_NAME_LENGTH) +
+                           " letters, digits, '_' or '-'.");
+        ELOG("Launch -shm parameters abnormal!");
+        return false;
+    }
+    sharedMemoryName = name;
+    ILOG("CommandParser shared memory ring: %s", sharedMemoryName.c_str());
+    return true;
+}
+
 bool CommandParser::IsMainArgLengthInvalid(const char* str) const
 {
     size_t argLength = strlen(str);
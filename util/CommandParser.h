@@ -58,6 +58,14 @@ public:
     bool IsComponentMode() const;
     std::string GetAbilityPath() const;
     bool IsStaticCard() const;
+    uint32_t GetJpegStripCount() const;
+    bool IsAdaptiveQuality() const;
+    int GetMinJpgQuality() const;
+    int GetMaxJpgQuality() const;
+    int GetMinFrameRate() const;
+    std::string GetFrameCodec() const;
+    std::string GetSharedMemoryName() const;
+    int32_t GetMaxResolution() const;
     bool IsMainArgLengthInvalid(const char* str) const;
 
 private:
@@ -81,6 +89,7 @@ private:
     };
     const std::vector<std::string> cardDisplayDevices = {"phone", "tablet", "wearable", "car", "tv", "2in1", "default"};
     const std::vector<std::string> projectModels = {"FA", "Stage"};
+    const std::vector<std::string> frameCodecs = {"jpeg", "raw", "lz4", "qoi", "delta"};
     const int MIN_PORT = 1024;
     const int MAX_PORT = 65535;
     const int32_t MIN_RESOLUTION = 1;
@@ -88,6 +97,13 @@ private:
     const int MAX_JSHEAPSIZE = 512 * 1024;
     const int MIN_JSHEAPSIZE = 48 * 1024;
     const size_t MAX_NAME_LENGTH = 256;
+    const int MIN_JPEG_STRIPS = 1;
+    const int MAX_JPEG_STRIPS = 16;
+    const int MIN_JPEG_QUALITY = 1;
+    const int MAX_JPEG_QUALITY = 100;
+    const int MIN_FRAME_RATE = 1;
+    const int MAX_FRAME_RATE = 25; // VirtualScreen sends at most one frame per 40 ms
+    const size_t MAX_SHM_NAME_LENGTH = 24;
     bool isSendJSHeap;
     int32_t orignalResolutionWidth;
     int32_t orignalResolutionHeight;
@@ -113,6 +129,13 @@ private:
     bool isComponentMode;
     std::string abilityPath;
     bool staticCard;
+    uint32_t jpegStripCount;
+    bool isAdaptiveQuality;
+    int minJpgQuality;
+    int maxJpgQuality;
+    int minFrameRate;
+    std::string frameCodec;
+    std::string sharedMemoryName;
     const size_t maxMainArgLength = 1024;
 
     bool IsDebugPortValid();
@@ -147,6 +170,10 @@ private:
     bool IsComponentModeValid();
     bool IsAbilityPathValid();
     bool IsStaticCardValid();
+    bool IsJpegStripsValid();
+    bool IsAdaptiveQualityValid();
+    bool IsFrameCodecValid();
+    bool IsSharedMemoryNameValid();
     std::string HelpText();
     void ProcessingCommand(const std::vector<std::string>& strs);
 };
@@ -47,6 +47,16 @@ void CppTimer::Stop()
     isRunning = false;
 }
 
+int64_t CppTimer::GetWaitTime() const
+{
+    // RunTimerTick ignores the timer on other threads, it must not look due there forever.
+    if (interval == 0 || !isRunning || shotTimes == 0 || this_thread::get_id() != threadId) {
+        return -1;
+    }
+    int64_t timePassed = duration_cast<chrono::milliseconds>(system_clock::now() - startTime).count();
+    return std::max<int64_t>(interval - timePassed, 0);
+}
+
 void CppTimer::RunTimerTick(CallbackQueue& queue)
 {
     if (interval == 0) {
@@ -73,6 +73,9 @@ public:
 
     void RunTimerTick(CallbackQueue& queue);
 
+    // Milliseconds until RunTimerTick runs the callback, -1 if it never will.
+    int64_t GetWaitTime() const;
+
 private:
     int64_t interval;
     int32_t shotTimes;
@@ -15,6 +15,7 @@
 
 #include "CppTimerManager.h"
 
+#include <algorithm>
 #include <thread>
 
 using namespace std;
@@ -42,6 +43,18 @@ void CppTimerManager::RemoveCppTimer(CppTimer& timer)
     ILOG("CppTimerManager::RemoveCppTimer %x %x", this, &timer);
 }
 
+std::chrono::milliseconds CppTimerManager::GetWaitTime() const
+{
+    int64_t waitTime = maxWaitTime.count();
+    for (const CppTimer* timer : runningTimers) {
+        int64_t timerWaitTime = timer->GetWaitTime();
+        if (timerWaitTime >= 0) {
+            waitTime = std::min(waitTime, timerWaitTime);
+        }
+    }
+    return std::chrono::milliseconds(waitTime);
+}
+
 void CppTimerManager::RunTimerTick()
 {
     std::list<CppTimer*> tempTimers = runningTimers;
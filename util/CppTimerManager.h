@@ -16,6 +16,7 @@
 #ifndef CPPTIMERMANAGER_H
 #define CPPTIMERMANAGER_H
 
+#include <chrono>
 #include <list>
 #include <map>
 #include <memory>
@@ -37,8 +38,12 @@ public:
     void RemoveCppTimer(CppTimer& timer);
 
     void RunTimerTick();
+    // Time until the next timer is due, at most maxWaitTime so a thread that blocks in between never sleeps
+    // for long on state another thread changed without waking it up.
+    std::chrono::milliseconds GetWaitTime() const;
 
 private:
+    static constexpr std::chrono::milliseconds maxWaitTime {1000};
     std::list<CppTimer*> runningTimers;
     CallbackQueue callbackQueue;
     static std::map<std::thread::id, std::unique_ptr<CppTimerManager>> managers;
@@ -0,0 +1,76 @@
+/*
+ * Copyright (c) 2023 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef EVENTLOOP_H
+#define EVENTLOOP_H
+
+#include <chrono>
+#include <mutex>
+#include <set>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif // _WIN32
+
+#include "LocalSocket.h"
+
+// Blocks a polling thread until it has something to do: a watched socket received data, the wait time passed
+// (the next CppTimer of the thread is due) or another thread called Wakeup. An idle thread does not wake up.
+//   linux   - epoll on the sockets, a timerfd for the timeout and an eventfd for wakeups
+//   mac     - poll on the sockets and a self pipe
+//   windows - an event for wakeups and a pending zero byte read on the pipe, its event is set once data arrived
+class EventLoop {
+public:
+    EventLoop();
+    ~EventLoop();
+    EventLoop(const EventLoop&) = delete;
+    EventLoop& operator=(const EventLoop&) = delete;
+
+    // The socket has to stay connected while it is watched, it is no longer watched once the peer closed it.
+    void WatchSocket(const LocalSocket& socket);
+    // Returns when a watched socket is readable, after Wakeup or once timeout passed.
+    void Wait(std::chrono::milliseconds timeout);
+    // May be called from any thread, a Wakeup before Wait makes the next Wait return at once.
+    void Wakeup();
+    // Wakes up every event loop, e.g. to let them see Interrupter::IsInterrupt.
+    static void WakeupAll();
+
+private:
+#ifdef _WIN32
+    bool IsPipeReadable();
+    void FinishPipeRead();
+    static constexpr int pipePollInterval = 1; // ms, only without events
+    HANDLE wakeupEvent;
+    HANDLE readEvent;
+    HANDLE pipeHandle;
+    OVERLAPPED readOverlapped;
+    bool isReadPending;
+#elif defined(__linux__)
+    int epollHandle;
+    int timerHandle;
+    int wakeupHandle;
+#else
+    std::vector<int> socketHandles;
+    int wakeupPipe[2];
+#endif // _WIN32
+    void Register();
+    void Unregister();
+
+    static std::set<EventLoop*> eventLoops;
+    static std::mutex eventLoopsMutex;
+};
+
+#endif // EVENTLOOP_H
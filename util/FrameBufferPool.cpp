@@ -0,0 +1,110 @@
+/*
+ * Copyright (c) 2023 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "FrameBufferPool.h"
+
+#include "PreviewerEngineLog.h"
+#include "libwebsockets.h"
+
+void FrameBufferPool::Recycler::operator()(uint8_t* data) const
+{
+    if (data != nullptr) {
+        FrameBufferPool::GetInstance().Release(data - LWS_PRE, sizeClass);
+    }
+}
+
+FrameBufferPool::FrameBufferPool() : allocationCount(0), acquireCount(0), pendingAllocationCount(0) {}
+
+FrameBufferPool& FrameBufferPool::GetInstance()
+{
+    // Never destroyed, buffers owned by other singletons are still released during static destruction.
+    static FrameBufferPool* pool = new FrameBufferPool();
+    return *pool;
+}
+
+size_t FrameBufferPool::GetSizeClass(size_t size)
+{
+    size_t shift = MIN_CLASS_SHIFT;
+    while (shift < MAX_CLASS_SHIFT && (static_cast<size_t>(1) << shift) < size) {
+        shift++;
+    }
+    return shift - MIN_CLASS_SHIFT;
+}
+
+size_t FrameBufferPool::GetClassCapacity(size_t sizeClass)
+{
+    return static_cast<size_t>(1) << (sizeClass + MIN_CLASS_SHIFT);
+}
+
+size_t FrameBufferPool::GetCapacity(const Buffer& buffer)
+{
+    if (buffer == nullptr) {
+        return 0;
+    }
+    return GetClassCapacity(buffer.get_deleter().GetSizeClass());
+}
+
+FrameBufferPool::Buffer FrameBufferPool::Acquire(size_t size)
+{
+    size_t sizeClass = GetSizeClass(size);
+    if (GetClassCapacity(sizeClass) < size) {
+        ELOG("FrameBufferPool::Acquire size %zu is too large", size);
+        return Buffer(nullptr, Recycler(sizeClass));
+    }
+    acquireCount++;
+    uint8_t* base = nullptr;
+    {
+        std::lock_guard<std::mutex> guard(mutex);
+        std::vector<uint8_t*>& freeList = freeLists[sizeClass];
+        if (!freeList.empty()) {
+            base = freeList.back();
+            freeList.pop_back();
+        }
+    }
+    if (base == nullptr) {
+        base = new uint8_t[LWS_PRE + GetClassCapacity(sizeClass)];
+        allocationCount++;
+        pendingAllocationCount++;
+    }
+    return Buffer(base + LWS_PRE, Recycler(sizeClass));
+}
+
+void FrameBufferPool::Release(uint8_t* data, size_t sizeClass)
+{
+    {
+        std::lock_guard<std::mutex> guard(mutex);
+        std::vector<uint8_t*>& freeList = freeLists[sizeClass];
+        if (freeList.size() < MAX_FREE_PER_CLASS) {
+            freeList.push_back(data);
+            return;
+        }
+    }
+    delete [] data;
+}
+
+uint64_t FrameBufferPool::GetAllocationCount() const
+{
+    return allocationCount;
+}
+
+uint64_t FrameBufferPool::GetAcquireCount() const
+{
+    return acquireCount;
+}
+
+uint64_t FrameBufferPool::TakeAllocationCount()
+{
+    return pendingAllocationCount.exchange(0);
+}
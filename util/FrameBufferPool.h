@@ -0,0 +1,76 @@
+/*
+ * Copyright (c) 2023 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FRAMEBUFFERPOOL_H
+#define FRAMEBUFFERPOOL_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// Size-classed pool for frame sized buffers. Every buffer has LWS_PRE bytes of headroom in front of the
+// returned pointer, so it can be handed to lws_write directly. Buffers go back to the pool when released.
+class FrameBufferPool {
+public:
+    class Recycler {
+    public:
+        Recycler() : sizeClass(0) {}
+        explicit Recycler(size_t index) : sizeClass(index) {}
+        void operator()(uint8_t* data) const;
+        size_t GetSizeClass() const
+        {
+            return sizeClass;
+        }
+
+    private:
+        size_t sizeClass;
+    };
+    using Buffer = std::unique_ptr<uint8_t[], Recycler>;
+
+    FrameBufferPool(const FrameBufferPool&) = delete;
+    FrameBufferPool& operator=(const FrameBufferPool&) = delete;
+    static FrameBufferPool& GetInstance();
+
+    // The returned buffer holds at least size bytes after the LWS_PRE headroom.
+    Buffer Acquire(size_t size);
+    static size_t GetCapacity(const Buffer& buffer);
+
+    uint64_t GetAllocationCount() const;
+    uint64_t GetAcquireCount() const;
+    // Returns the number of heap allocations since the last call, used by the per-minute frame statistics.
+    uint64_t TakeAllocationCount();
+
+private:
+    FrameBufferPool();
+    ~FrameBufferPool() {}
+    void Release(uint8_t* data, size_t sizeClass);
+    static size_t GetSizeClass(size_t size);
+    static size_t GetClassCapacity(size_t sizeClass);
+
+    static constexpr size_t MIN_CLASS_SHIFT = 12; // 4 KB
+    static constexpr size_t MAX_CLASS_SHIFT = 31; // 2 GB
+    static constexpr size_t CLASS_COUNT = MAX_CLASS_SHIFT - MIN_CLASS_SHIFT + 1;
+    static constexpr size_t MAX_FREE_PER_CLASS = 4;
+    std::mutex mutex;
+    std::vector<uint8_t*> freeLists[CLASS_COUNT];
+    std::atomic<uint64_t> allocationCount;
+    std::atomic<uint64_t> acquireCount;
+    std::atomic<uint64_t> pendingAllocationCount;
+};
+
+#endif // FRAMEBUFFERPOOL_H
@@ -0,0 +1,138 @@
+/*
+ * Copyright (c) 2023 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "FrameQueue.h"
+
+#include <algorithm>
+
+FrameQueue::FrameQueue(size_t capacity)
+    : slots(capacity > 0 ? capacity : 1), head(0), count(0), isStopped(false), isWokenUp(false), droppedCount(0)
+{
+}
+
+bool FrameQueue::Push(Frame&& frame)
+{
+    bool isDropped = false;
+    Frame staleFrame;
+    {
+        std::lock_guard<std::mutex> guard(mutex);
+        if (count == slots.size()) {
+            // Latest frame wins: release the oldest frame outside the lock.
+            staleFrame = std::move(slots[head]);
+            frame.isKeyFrame = frame.isKeyFrame || staleFrame.isKeyFrame;
+            frame.protocolVersion = std::max(frame.protocolVersion, staleFrame.protocolVersion);
+            head = (head + 1) % slots.size();
+            count--;
+            isDropped = true;
+        }
+        slots[(head + count) % slots.size()] = std::move(frame);
+        count++;
+    }
+    notEmpty.notify_one();
+    if (isDropped) {
+        droppedCount++;
+    }
+    return !isDropped;
+}
+
+bool FrameQueue::Pop(Frame& frame, std::chrono::milliseconds timeout)
+{
+    frame.data.reset();
+    std::unique_lock<std::mutex> lock(mutex);
+    notEmpty.wait_for(lock, timeout, [this]() { return count > 0 || isStopped || isWokenUp; });
+    isWokenUp = false;
+    if (isStopped) {
+        return false;
+    }
+    if (count == 0) {
+        return true;
+    }
+    frame = std::move(slots[head]);
+    head = (head + 1) % slots.size();
+    count--;
+    return true;
+}
+
+bool FrameQueue::PopLatest(Frame& frame, size_t& replacedCount)
+{
+    std::vector<Frame> staleFrames;
+    replacedCount = 0;
+    {
+        std::lock_guard<std::mutex> guard(mutex);
+        if (isStopped) {
+            return false;
+        }
+        if (count == 0) {
+            return true;
+        }
+        // Release the replaced frames outside the lock, a keyframe request and the highest protocol version carry
+        // over to the newest frame.
+        bool isKeyFrame = frame.isKeyFrame;
+        uint16_t protocolVersion = frame.protocolVersion;
+        staleFrames.reserve(count);
+        staleFrames.push_back(std::move(frame));
+        while (count > 0) {
+            isKeyFrame = isKeyFrame || slots[head].isKeyFrame;
+            protocolVersion = std::max(protocolVersion, slots[head].protocolVersion);
+            if (count > 1) {
+                staleFrames.push_back(std::move(slots[head]));
+            } else {
+                frame = std::move(slots[head]);
+            }
+            head = (head + 1) % slots.size();
+            count--;
+        }
+        frame.isKeyFrame = isKeyFrame;
+        frame.protocolVersion = protocolVersion;
+        replacedCount = staleFrames.size();
+    }
+    droppedCount += replacedCount;
+    return true;
+}
+
+bool FrameQueue::Wait(std::chrono::milliseconds timeout)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    return !notEmpty.wait_for(lock, timeout, [this]() { return isStopped; });
+}
+
+void FrameQueue::Wakeup()
+{
+    {
+        std::lock_guard<std::mutex> guard(mutex);
+        isWokenUp = true;
+    }
+    notEmpty.notify_all();
+}
+
+void FrameQueue::Stop()
+{
+    {
+        std::lock_guard<std::mutex> guard(mutex);
+        isStopped = true;
+    }
+    notEmpty.notify_all();
+}
+
+size_t FrameQueue::GetDepth() const
+{
+    std::lock_guard<std::mutex> guard(mutex);
+    return count;
+}
+
+uint64_t FrameQueue::GetDroppedCount() const
+{
+    return droppedCount;
+}
@@ -0,0 +1,75 @@
+/*
+ * Copyright (c) 2023 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FRAMEQUEUE_H
+#define FRAMEQUEUE_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include "FrameBufferPool.h"
+
+// Bounded hand-off queue between the render callback and the encoder thread.
+// When the queue is full the oldest frame is dropped, so the consumer always sees the latest frames.
+class FrameQueue {
+public:
+    struct Frame {
+        FrameBufferPool::Buffer data;
+        size_t length = 0;
+        int32_t width = 0;
+        int32_t height = 0;
+        bool isKeyFrame = false; // sent as a full frame even in region refresh mode
+        uint16_t protocolVersion = 0; // written to the frame header, 0 if the producer leaves it to the consumer
+        std::chrono::steady_clock::time_point renderTime; // entry of the render callback
+    };
+
+    explicit FrameQueue(size_t capacity);
+    ~FrameQueue() {}
+    FrameQueue(const FrameQueue&) = delete;
+    FrameQueue& operator=(const FrameQueue&) = delete;
+
+    // Returns false if an older frame had to be dropped to make room.
+    bool Push(Frame&& frame);
+    // Blocks until a frame is available, Wakeup is called or timeout passed, frame.data is null if no frame was
+    // taken. Returns false once the queue is stopped.
+    bool Pop(Frame& frame, std::chrono::milliseconds timeout);
+    // Replaces frame with the newest queued frame without blocking and drops the older ones, replacedCount is
+    // the number of frames replaced, including the one passed in. Returns false once the queue is stopped.
+    bool PopLatest(Frame& frame, size_t& replacedCount);
+    // Sleeps for timeout without taking a frame, returns false as soon as the queue is stopped.
+    bool Wait(std::chrono::milliseconds timeout);
+    // Makes a blocked Pop return without a frame, may be called from any thread.
+    void Wakeup();
+    void Stop();
+
+    size_t GetDepth() const;
+    uint64_t GetDroppedCount() const;
+
+private:
+    std::vector<Frame> slots;
+    size_t head;
+    size_t count;
+    bool isStopped;
+    bool isWokenUp;
+    mutable std::mutex mutex;
+    std::condition_variable notEmpty;
+    std::atomic<uint64_t> droppedCount;
+};
+
+#endif // FRAMEQUEUE_H
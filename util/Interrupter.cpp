@@ -15,6 +15,8 @@
 
 #include "Interrupter.h"
 
+#include "EventLoop.h"
+
 std::atomic<bool> Interrupter::isInterrupt(false);
 
 bool Interrupter::IsInterrupt()
@@ -25,4 +27,5 @@ bool Interrupter::IsInterrupt()
 void Interrupter::Interrupt()
 {
     isInterrupt = true;
+    EventLoop::WakeupAll();
 }
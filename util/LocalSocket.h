@@ -16,6 +16,7 @@
 #ifndef LOCALSOCKET_H
 #define LOCALSOCKET_H
 
+#include <mutex>
 #include <string>
 
 #ifdef _WIN32
@@ -31,6 +32,12 @@ public:
 
     enum TransMode { TRANS_BYTE = 0, TRANS_MESSAGE };
 
+    // One part of a scatter-gather write, the data is sent from where it is without being copied.
+    struct Segment {
+        const void* data;
+        size_t length;
+    };
+
     LocalSocket();
     virtual ~LocalSocket();
     LocalSocket& operator=(const LocalSocket&) = delete;
@@ -42,23 +49,29 @@ public:
     void DisconnectFromServer();
     int64_t ReadData(char* data, size_t length) const;
     size_t WriteData(const void* data, size_t length) const;
+    // Writes all segments in order as one stream, partial writes are continued. Returns the bytes written.
+    // Safe to call from several threads, the segments of one call are never interleaved with those of another.
+    size_t WriteSegments(const Segment* segments, size_t count) const;
+    // Writes the message and its NUL terminator, the framing the command and trace pipes use.
+    size_t WriteMessage(const char* data, size_t length) const;
+    size_t WriteMessage(const std::string& message) const;
 
     template <class T, class = typename std::enable_if<std::is_integral<T>::value>::type>
     const LocalSocket& operator<<(const T data) const
     {
         T dataToSend = EndianUtil::ToNetworkEndian<T>(data);
-        char* startPos = reinterpret_cast<char*>(&dataToSend);
-        char buffer[sizeof(T)];
-        std::copy(startPos, startPos + sizeof(dataToSend), buffer);
-        WriteData(buffer, sizeof(dataToSend));
+        WriteData(&dataToSend, sizeof(dataToSend));
         return *this;
     }
 
-    const LocalSocket& operator<<(const std::string data) const;
+    const LocalSocket& operator<<(const std::string& data) const;
 
     const LocalSocket& operator>>(std::string& data) const;
 
 private:
+    friend class EventLoop; // waits on the native handle
+    static constexpr size_t maxSegmentCount = 16; // at most this many segments per WriteSegments call
+    mutable std::mutex writeMutex; // held for a whole WriteSegments call
 #ifdef _WIN32
     HANDLE pipeHandle;
     DWORD GetWinOpenMode(OpenMode mode) const;
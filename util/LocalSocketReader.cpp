@@ -0,0 +1,91 @@
+/*
+ * Copyright (c) 2023 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "LocalSocketReader.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "PreviewerEngineLog.h"
+
+LocalSocketReader::LocalSocketReader(const LocalSocket& socket)
+    : socket(socket), buffer(readChunkSize), start(0), end(0), isDiscarding(false)
+{
+}
+
+size_t LocalSocketReader::ReadMessages(std::vector<std::string>& messages)
+{
+    size_t count = 0;
+    while (true) {
+        Reserve(readChunkSize);
+        size_t space = buffer.size() - end;
+        int64_t readSize = socket.ReadData(buffer.data() + end, space);
+        if (readSize <= 0) {
+            break;
+        }
+        size_t scanPos = end;
+        end += static_cast<size_t>(readSize);
+        count += ExtractMessages(messages, scanPos);
+        if (static_cast<size_t>(readSize) < space) {
+            break; // everything pending has been read
+        }
+    }
+    return count;
+}
+
+void LocalSocketReader::Reserve(size_t size)
+{
+    if (buffer.size() - end >= size) {
+        return;
+    }
+    // Move the incomplete message to the front, the buffer only grows for messages longer than it.
+    if (start > 0) {
+        std::memmove(buffer.data(), buffer.data() + start, end - start);
+        end -= start;
+        start = 0;
+    }
+    if (buffer.size() - end < size) {
+        buffer.resize(std::max(buffer.size() * 2, end + size)); // 2: grow geometrically
+    }
+}
+
+size_t LocalSocketReader::ExtractMessages(std::vector<std::string>& messages, size_t scanPos)
+{
+    size_t count = 0;
+    while (scanPos < end) {
+        const char* terminator = static_cast<const char*>(std::memchr(buffer.data() + scanPos, '\0', end - scanPos));
+        if (terminator == nullptr) {
+            break;
+        }
+        size_t terminatorPos = static_cast<size_t>(terminator - buffer.data());
+        if (!isDiscarding && terminatorPos > start) {
+            messages.emplace_back(buffer.data() + start, terminatorPos - start);
+            count++;
+        }
+        isDiscarding = false;
+        start = terminatorPos + 1;
+        scanPos = start;
+    }
+    if (end - start > maxMessageSize) {
+        ELOG("LocalSocketReader::ExtractMessages message longer than %zu bytes dropped", maxMessageSize);
+        isDiscarding = true;
+        start = end;
+    }
+    if (start == end) {
+        start = 0;
+        end = 0;
+    }
+    return count;
+}
@@ -0,0 +1,51 @@
+/*
+ * Copyright (c) 2023 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LOCALSOCKETREADER_H
+#define LOCALSOCKETREADER_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "LocalSocket.h"
+
+// Splits the byte stream of a LocalSocket into NUL terminated messages. All pending bytes are read with a few
+// large reads instead of one read per byte, a message that is not complete yet stays buffered for the next call.
+class LocalSocketReader {
+public:
+    explicit LocalSocketReader(const LocalSocket& socket);
+    ~LocalSocketReader() {}
+    LocalSocketReader(const LocalSocketReader&) = delete;
+    LocalSocketReader& operator=(const LocalSocketReader&) = delete;
+
+    // Appends every complete message to messages without blocking, returns the number of messages appended.
+    // Empty messages are skipped.
+    size_t ReadMessages(std::vector<std::string>& messages);
+
+private:
+    void Reserve(size_t size);
+    size_t ExtractMessages(std::vector<std::string>& messages, size_t scanPos);
+
+    static constexpr size_t readChunkSize = 16 * 1024;
+    static constexpr size_t maxMessageSize = 16 * 1024 * 1024; // longer messages are dropped
+    const LocalSocket& socket;
+    std::vector<char> buffer;
+    size_t start; // first byte of the message being received
+    size_t end;   // end of the received bytes
+    bool isDiscarding; // the current message is too long, it is skipped until its terminating NUL
+};
+
+#endif // LOCALSOCKETREADER_H
@@ -0,0 +1,139 @@
+/*
+ * Copyright (c) 2023 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "PerfStats.h"
+
+#include <algorithm>
+
+namespace {
+const char* const STAGE_NAMES[] = { "callback", "queue", "convert", "encode", "write", "ack", "total" };
+const int PERCENT = 100;
+}
+
+PerfStats& PerfStats::GetInstance()
+{
+    static PerfStats instance;
+    return instance;
+}
+
+PerfStats::PerfStats() : frameCount(0), byteCount(0)
+{
+    intervalStart = std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now().time_since_epoch()).count();
+}
+
+void PerfStats::Record(Stage stage, int64_t us)
+{
+    if (stage < Stage::COUNT) {
+        histograms[static_cast<size_t>(stage)].Record(us);
+    }
+}
+
+PerfStats::Clock::time_point PerfStats::Record(Stage stage, Clock::time_point start)
+{
+    Clock::time_point now = Clock::now();
+    Record(stage, std::chrono::duration_cast<std::chrono::microseconds>(now - start).count());
+    return now;
+}
+
+void PerfStats::AddSentFrame(size_t bytes)
+{
+    frameCount.fetch_add(1, std::memory_order_relaxed);
+    byteCount.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+PerfStats::Summary PerfStats::TakeSummary()
+{
+    Summary summary;
+    int64_t now = std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now().time_since_epoch()).count();
+    summary.intervalMs = now - intervalStart.exchange(now);
+    summary.frameCount = frameCount.exchange(0);
+    summary.byteCount = byteCount.exchange(0);
+    for (size_t i = 0; i < histograms.size(); i++) {
+        summary.stages.push_back(histograms[i].Take(STAGE_NAMES[i]));
+    }
+    return summary;
+}
+
+PerfStats::Histogram::Histogram() : sum(0), max(0)
+{
+    for (auto& bucket : buckets) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+}
+
+void PerfStats::Histogram::Record(int64_t us)
+{
+    us = std::max<int64_t>(us, 0);
+    buckets[GetBucket(static_cast<uint64_t>(us))].fetch_add(1, std::memory_order_relaxed);
+    sum.fetch_add(static_cast<uint64_t>(us), std::memory_order_relaxed);
+    int64_t last = max.load(std::memory_order_relaxed);
+    while (us > last && !max.compare_exchange_weak(last, us, std::memory_order_relaxed)) {
+    }
+}
+
+PerfStats::StageSummary PerfStats::Histogram::Take(const char* name)
+{
+    // Records arriving while the buckets are taken end up in this or in the next interval, never in both.
+    std::array<uint64_t, bucketCount> counts;
+    uint64_t total = 0;
+    for (size_t i = 0; i < bucketCount; i++) {
+        counts[i] = buckets[i].exchange(0, std::memory_order_relaxed);
+        total += counts[i];
+    }
+    uint64_t totalUs = sum.exchange(0, std::memory_order_relaxed);
+    int64_t maxUs = max.exchange(0, std::memory_order_relaxed);
+
+    StageSummary summary = { name, total, 0, 0, 0, 0, maxUs };
+    if (total == 0) {
+        return summary;
+    }
+    summary.meanUs = static_cast<int64_t>(totalUs / total);
+    const uint64_t percentiles[] = { 50, 90, 99 };
+    int64_t* values[] = { &summary.p50Us, &summary.p90Us, &summary.p99Us };
+    uint64_t seen = 0;
+    size_t next = 0;
+    for (size_t i = 0; i < bucketCount && next < sizeof(percentiles) / sizeof(percentiles[0]); i++) {
+        seen += counts[i];
+        // The value at rank ceil(p * total / 100) is reported as the upper bound of its bucket.
+        while (next < sizeof(percentiles) / sizeof(percentiles[0]) &&
+               seen * PERCENT >= percentiles[next] * total) {
+            *values[next] = std::min(GetBucketValue(i), std::max<int64_t>(maxUs, 0));
+            next++;
+        }
+    }
+    return summary;
+}
+
+size_t PerfStats::Histogram::GetBucket(uint64_t value)
+{
+    const uint64_t maxValue = (static_cast<uint64_t>(1) << maxValueBits) - 1;
+    value = std::min(value, maxValue);
+    size_t shift = 0;
+    while ((value >> shift) >= (static_cast<uint64_t>(2) << subBucketBits)) {
+        shift++;
+    }
+    return (shift << subBucketBits) + static_cast<size_t>(value >> shift);
+}
+
+int64_t PerfStats::Histogram::GetBucketValue(size_t bucket)
+{
+    const size_t subBucketCount = static_cast<size_t>(1) << subBucketBits;
+    if (bucket < subBucketCount * 2) { // 2: the first two ranges hold one value per bucket
+        return static_cast<int64_t>(bucket);
+    }
+    size_t shift = (bucket >> subBucketBits) - 1;
+    uint64_t mantissa = (bucket & (subBucketCount - 1)) + subBucketCount;
+    return static_cast<int64_t>(((mantissa + 1) << shift) - 1);
+}
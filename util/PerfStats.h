@@ -0,0 +1,96 @@
+/*
+ * Copyright (c) 2023 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef PERFSTATS_H
+#define PERFSTATS_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Per stage latency histograms of the frame pipeline, recorded lock-free from any thread and returned by the
+// PerfStats command. The histograms are log-linear like HDR histograms: 16 buckets per power of two keep the
+// error of a percentile below 1/16 over the whole range of 1 us to 2^27 us.
+class PerfStats {
+public:
+    enum class Stage {
+        CALLBACK = 0, // render callback, from entry until the frame is handed over
+        QUEUE,        // render callback entry until the frame is picked up for sending, pacing included
+        CONVERT,      // scaling and dirty region detection
+        ENCODE,
+        WRITE,        // handing the encoded frame to the transport
+        ACK,          // queued for a websocket client until it is written to its socket
+        TOTAL,        // render callback entry until the frame is written
+        COUNT
+    };
+    struct StageSummary {
+        const char* name;
+        uint64_t count;
+        int64_t meanUs;
+        int64_t p50Us;
+        int64_t p90Us;
+        int64_t p99Us;
+        int64_t maxUs;
+    };
+    struct Summary {
+        int64_t intervalMs;
+        uint64_t frameCount;
+        uint64_t byteCount;
+        std::vector<StageSummary> stages;
+    };
+    using Clock = std::chrono::steady_clock;
+
+    PerfStats(const PerfStats&) = delete;
+    PerfStats& operator=(const PerfStats&) = delete;
+    static PerfStats& GetInstance();
+
+    void Record(Stage stage, int64_t us);
+    // Records the time since start and returns the current time, so consecutive stages can be chained.
+    Clock::time_point Record(Stage stage, Clock::time_point start);
+    void AddSentFrame(size_t bytes);
+    // Returns the statistics since the previous call and starts a new interval.
+    Summary TakeSummary();
+
+private:
+    class Histogram {
+    public:
+        Histogram();
+        void Record(int64_t us);
+        StageSummary Take(const char* name);
+
+    private:
+        static constexpr int subBucketBits = 4;
+        static constexpr int maxValueBits = 27; // about 134 s, longer durations are clamped
+        static constexpr size_t bucketCount = (maxValueBits - subBucketBits + 1) << subBucketBits;
+        static size_t GetBucket(uint64_t value);
+        static int64_t GetBucketValue(size_t bucket);
+
+        std::array<std::atomic<uint64_t>, bucketCount> buckets;
+        std::atomic<uint64_t> sum;
+        std::atomic<int64_t> max;
+    };
+
+    PerfStats();
+    ~PerfStats() {}
+    std::array<Histogram, static_cast<size_t>(Stage::COUNT)> histograms;
+    std::atomic<uint64_t> frameCount;
+    std::atomic<uint64_t> byteCount;
+    std::atomic<int64_t> intervalStart; // steady clock ms
+};
+
+#endif // PERFSTATS_H
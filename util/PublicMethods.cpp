@@ -44,3 +44,28 @@ uint32_t PublicMethods::Ulltoa(uintptr_t value, int8_t (&rstStr)[MAX_ITOA_BIT])
     *tmpRstStr = 0;
     return rstLength;
 }
+
+bool PublicMethods::IsValidVersion(const string& version)
+{
+    const size_t versionPartCount = 3;
+    size_t partCount = 0;
+    size_t pos = 0;
+    while (partCount < versionPartCount) {
+        size_t partStart = pos;
+        while (pos < version.size() && version[pos] >= '0' && version[pos] <= '9') {
+            pos++;
+        }
+        size_t partLength = pos - partStart;
+        if (partLength == 0 || (partLength > 1 && version[partStart] == '0')) {
+            return false;
+        }
+        partCount++;
+        if (partCount < versionPartCount) {
+            if (pos >= version.size() || version[pos] != '.') {
+                return false;
+            }
+            pos++;
+        }
+    }
+    return pos == version.size();
+}
@@ -30,6 +30,8 @@ public:
     PublicMethods& operator=(const PublicMethods&) = delete;
     PublicMethods(const PublicMethods&) = delete;
     static uint32_t Ulltoa(uintptr_t value, int8_t (&rstStr)[MAX_ITOA_BIT]);
+    // major.minor.patch, every part is a decimal number without leading zeros.
+    static bool IsValidVersion(const std::string& version);
 };
 
 #endif // LOCALSOCKET_H
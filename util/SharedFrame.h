@@ -0,0 +1,60 @@
+/*
+ * Copyright (c) 2023 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SHAREDFRAME_H
+#define SHAREDFRAME_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "FrameBufferPool.h"
+
+// An encoded frame that is never written again once it is published. Holders share it by reference, so
+// the last frame can be kept for reconnecting clients without copying it or holding a lock while it is sent.
+// The buffer goes back to FrameBufferPool with the last reference.
+class SharedFrame {
+public:
+    SharedFrame(FrameBufferPool::Buffer&& frameBuffer, size_t frameSize)
+        : buffer(std::move(frameBuffer)), size(frameSize)
+    {
+    }
+    SharedFrame(const SharedFrame&) = delete;
+    SharedFrame& operator=(const SharedFrame&) = delete;
+
+    const uint8_t* GetData() const
+    {
+        return buffer.get();
+    }
+
+    // lws_write takes a mutable pointer, it only writes its framing into the LWS_PRE headroom in front of it.
+    unsigned char* GetWriteData() const
+    {
+        return buffer.get();
+    }
+
+    size_t GetSize() const
+    {
+        return size;
+    }
+
+private:
+    const FrameBufferPool::Buffer buffer;
+    const size_t size;
+};
+
+using SharedFramePtr = std::shared_ptr<const SharedFrame>;
+
+#endif // SHAREDFRAME_H
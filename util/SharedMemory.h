@@ -0,0 +1,70 @@
+/*
+ * Copyright (c) 2023 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SHAREDMEMORY_H
+#define SHAREDMEMORY_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <semaphore.h>
+#endif // _WIN32
+
+// A named shared memory object with a named semaphore as doorbell, other processes open both by name.
+// Unix: shm_open("/<name>") and sem_open("/<name>.bell"). Windows: "Local\<name>" and "Local\<name>.bell".
+class SharedMemory {
+public:
+    SharedMemory();
+    virtual ~SharedMemory();
+    SharedMemory(const SharedMemory&) = delete;
+    SharedMemory& operator=(const SharedMemory&) = delete;
+
+    // Creates and maps size zeroed bytes. The pages only take memory once they are committed and written.
+    bool Create(const std::string& name, size_t size);
+    // Maps the first size bytes of an object another process created, used by consumers.
+    bool Open(const std::string& name, size_t size);
+    // Unmaps the memory, the names are removed only by the process that created them.
+    void Destroy();
+    uint8_t* GetData() const;
+    size_t GetSize() const;
+    // Makes [offset, offset + length) writable and fails if there is no memory left for it. Writing pages that
+    // were not committed may crash the process where the memory is limited, like /dev/shm on Linux.
+    bool Commit(size_t offset, size_t length);
+    // Wakes a consumer waiting on the doorbell.
+    void Notify() const;
+    // Waits until the doorbell rang, false on timeout.
+    bool Wait(std::chrono::milliseconds timeout) const;
+
+private:
+    uint8_t* data;
+    size_t size;
+#ifdef _WIN32
+    HANDLE mappingHandle;
+    HANDLE doorbellHandle;
+#else
+    int fileHandle;
+    sem_t* doorbell;
+    std::string memoryName;
+    std::string doorbellName;
+    bool isOwner;
+#endif // _WIN32
+};
+
+#endif // SHAREDMEMORY_H
@@ -0,0 +1,109 @@
+/*
+ * Copyright (c) 2023 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "SharedMemoryRing.h"
+
+#include <algorithm>
+
+#include "PreviewerEngineLog.h"
+
+SharedMemoryRing& SharedMemoryRing::GetInstance()
+{
+    static SharedMemoryRing instance;
+    return instance;
+}
+
+SharedMemoryRing::SharedMemoryRing() : header(nullptr) {}
+
+SharedMemoryRing::~SharedMemoryRing()
+{
+    Close();
+}
+
+bool SharedMemoryRing::Open(const std::string& name, size_t maxFrameSize)
+{
+    std::lock_guard<std::mutex> guard(writeMutex);
+    header = nullptr;
+    size_t slotStride = (sizeof(SlotHeader) + maxFrameSize + cacheLineSize - 1) / cacheLineSize * cacheLineSize;
+    if (!memory.Create(name, ringHeaderSize + slotStride * SLOT_COUNT) || !memory.Commit(0, ringHeaderSize)) {
+        memory.Destroy();
+        return false;
+    }
+    header = reinterpret_cast<RingHeader*>(memory.GetData());
+    header->version = RING_VERSION;
+    header->slotCount = SLOT_COUNT;
+    header->slotStride = slotStride;
+    header->slotSize = maxFrameSize;
+    header->writeIndex.store(0, std::memory_order_relaxed);
+    header->attachCount.store(0, std::memory_order_relaxed);
+    header->magic.store(RING_MAGIC, std::memory_order_release);
+    committedSizes.assign(SLOT_COUNT, 0);
+    ILOG("SharedMemoryRing %s opened, %u slots of %zu bytes", name.c_str(), SLOT_COUNT, maxFrameSize);
+    return true;
+}
+
+void SharedMemoryRing::Close()
+{
+    std::lock_guard<std::mutex> guard(writeMutex);
+    header = nullptr;
+    memory.Destroy();
+}
+
+bool SharedMemoryRing::IsOpened() const
+{
+    return header != nullptr;
+}
+
+size_t SharedMemoryRing::WriteData(const uint8_t* data, size_t length)
+{
+    std::lock_guard<std::mutex> guard(writeMutex);
+    if (header == nullptr || data == nullptr) {
+        return 0;
+    }
+    if (length > header->slotSize) {
+        ELOG("SharedMemoryRing::WriteData frame of %zu bytes exceeds the slot size", length);
+        return 0;
+    }
+    uint64_t index = header->writeIndex.load(std::memory_order_relaxed) + 1;
+    uint64_t slotIndex = (index - 1) % SLOT_COUNT;
+    uint8_t* slot = GetSlot(index);
+    size_t slotLength = sizeof(SlotHeader) + length;
+    if (slotLength > committedSizes[slotIndex]) {
+        if (!memory.Commit(static_cast<size_t>(slot - memory.GetData()), slotLength)) {
+            return 0;
+        }
+        committedSizes[slotIndex] = slotLength;
+    }
+    SlotHeader* slotHeader = reinterpret_cast<SlotHeader*>(slot);
+    // Seqlock: an odd sequence marks the slot as being written, readers check it before and after reading.
+    slotHeader->sequence.store(index * 2 - 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slotHeader->length = length;
+    std::copy(data, data + length, slot + sizeof(SlotHeader));
+    slotHeader->sequence.store(index * 2, std::memory_order_release);
+    header->writeIndex.store(index, std::memory_order_release);
+    memory.Notify();
+    return length;
+}
+
+uint32_t SharedMemoryRing::GetAttachCount() const
+{
+    return header == nullptr ? 0 : header->attachCount.load(std::memory_order_relaxed);
+}
+
+uint8_t* SharedMemoryRing::GetSlot(uint64_t index) const
+{
+    return memory.GetData() + ringHeaderSize + static_cast<size_t>((index - 1) % SLOT_COUNT) * header->slotStride;
+}
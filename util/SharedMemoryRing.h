@@ -0,0 +1,88 @@
+/*
+ * Copyright (c) 2023 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SHAREDMEMORYRING_H
+#define SHAREDMEMORYRING_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "SharedMemory.h"
+
+// Frame transport for a client on the same host, selected with -shm <name> instead of the WebSocket.
+// Every frame, its 40 bytes packet header included, is written into the next slot of a ring in shared memory.
+//
+// Layout: RingHeader padded to ringHeaderSize, then SLOT_COUNT slots of slotStride bytes, each a SlotHeader
+// followed by the frame. tools/ShmRingConsumer.cpp is a reference consumer.
+// A consumer:
+//  1. Opens the memory and the doorbell by name (see SharedMemory), waits for magic to be RING_MAGIC, checks
+//     version and increments attachCount, so the next frame is a full frame.
+//  2. Waits on the doorbell and loads writeIndex, frame n (counted from 1) is in slot (n - 1) % slotCount.
+//  3. Loads the slot sequence, it is 2n once frame n is complete and odd while a frame is being written.
+//     The frame is read in place, then the sequence is loaded again after an acquire fence: the frame is
+//     valid if both loads returned 2n, otherwise the writer overtook the consumer and it waits for the next.
+// The doorbell may ring more often than frames arrive, a consumer only handles the newest frame. Region and delta
+// frames (see VirtualScreen::FrameCodec) apply on top of the previous frame: a consumer that missed one increments
+// attachCount again and ignores them until the next full key frame. The previewer polls attachCount and sends the
+// current frame again as a key frame within about 100 ms, even if nothing changes on the screen.
+class SharedMemoryRing {
+public:
+    struct RingHeader {
+        std::atomic<uint32_t> magic;       // written last, the ring is ready once it is RING_MAGIC
+        uint32_t version;
+        uint32_t slotCount;
+        uint32_t reserved;
+        uint64_t slotStride;               // distance between two slots
+        uint64_t slotSize;                 // maximum frame size of a slot
+        std::atomic<uint64_t> writeIndex;  // number of the last complete frame, 0 before the first one
+        std::atomic<uint32_t> attachCount; // incremented by every consumer that opens the ring
+    };
+    struct SlotHeader {
+        std::atomic<uint64_t> sequence;
+        uint64_t length;
+    };
+    static constexpr uint32_t RING_MAGIC = 0x53484D52; // "SHMR"
+    static constexpr uint32_t RING_VERSION = 1;
+    static constexpr uint32_t SLOT_COUNT = 3; // one being written, one being read and the one in between
+    static constexpr size_t cacheLineSize = 64; // slots start on their own cache line
+    static constexpr size_t ringHeaderSize = (sizeof(RingHeader) + cacheLineSize - 1) / cacheLineSize * cacheLineSize;
+
+    SharedMemoryRing(const SharedMemoryRing&) = delete;
+    SharedMemoryRing& operator=(const SharedMemoryRing&) = delete;
+    static SharedMemoryRing& GetInstance();
+
+    bool Open(const std::string& name, size_t maxFrameSize);
+    void Close();
+    bool IsOpened() const;
+    // Returns the written length, 0 if the ring is not open or the frame is larger than a slot.
+    size_t WriteData(const uint8_t* data, size_t length);
+    uint32_t GetAttachCount() const;
+
+private:
+    SharedMemoryRing();
+    virtual ~SharedMemoryRing();
+    uint8_t* GetSlot(uint64_t index) const;
+
+    SharedMemory memory;
+    RingHeader* header;
+    std::vector<size_t> committedSizes;
+    std::mutex writeMutex; // the encode and the load document threads may both send frames
+};
+
+#endif // SHAREDMEMORYRING_H
@@ -55,7 +55,7 @@ void TraceTool::SendTraceData(const Json::Value& value)
     ostringstream osStream;
     std::unique_ptr<Json::StreamWriter> writer(builder.newStreamWriter());
     writer->write(value, &osStream);
-    *(GetInstance().socket) << osStream.str();
+    GetInstance().socket->WriteMessage(osStream.str());
 }
 
 void TraceTool::HandleTrace(const string msg) const
@@ -14,19 +14,17 @@
  */
 
 #include <thread>
-#include "CommandLineInterface.h"
 #include "PreviewerEngineLog.h"
 #include "WebSocketServer.h"
 using namespace std;
 
-lws* WebSocketServer::webSocket = nullptr;
 bool WebSocketServer::interrupted = false;
-WebSocketServer::WebSocketState WebSocketServer::webSocketWritable = WebSocketState::INIT;
-uint8_t* WebSocketServer::firstImageBuffer = nullptr;
-uint64_t WebSocketServer::firstImagebufferSize = 0;
+std::atomic<WebSocketServer::WebSocketState> WebSocketServer::webSocketWritable(WebSocketState::INIT);
+std::atomic<uint32_t> WebSocketServer::connectionCount(0);
+std::atomic<uint32_t> WebSocketServer::keyFrameRequestCount(0);
 int8_t* WebSocketServer::receivedMessage = nullptr;
 
-WebSocketServer::WebSocketServer() : serverThread(nullptr), serverPort(0)
+WebSocketServer::WebSocketServer() : serverThread(nullptr), serverPort(0), serviceContext(nullptr)
 {
     protocols[0] = {"ws", WebSocketServer::ProtocolCallback, 0, MAX_PAYLOAD_SIZE};
     protocols[1] = {NULL, NULL, 0, 0};
@@ -56,27 +54,23 @@ int WebSocketServer::ProtocolCallback(struct lws* wsi,
             ILOG("Engine Websocket protocol init");
             break;
         case LWS_CALLBACK_ESTABLISHED:
-            ILOG("Websocket client connect");
-            webSocket = wsi;
+            GetInstance().AddClient(wsi);
+            connectionCount++;
+            GetInstance().RequestKeyFrame();
+            webSocketWritable = WebSocketState::WRITEABLE;
             lws_callback_on_writable(wsi);
             break;
         case LWS_CALLBACK_RECEIVE:
             break;
         case LWS_CALLBACK_SERVER_WRITEABLE:
-            ILOG("Engine websocket server writeable");
-            if (firstImagebufferSize > 0 && webSocketWritable == WebSocketState::UNWRITEABLE) {
-                ILOG("Send last image after websocket reconnected");
-                std::lock_guard<std::mutex> guard(WebSocketServer::GetInstance().mutex);
-                lws_write(wsi,
-                          firstImageBuffer + LWS_PRE,
-                          firstImagebufferSize,
-                          LWS_WRITE_BINARY);
-            }
-            webSocketWritable = WebSocketState::WRITEABLE;
+            GetInstance().SendPendingFrame(wsi);
+            break;
+        case LWS_CALLBACK_EVENT_WAIT_CANCELLED:
+            // WriteData queued a frame from another thread, writes may only be requested on the service thread.
+            GetInstance().RequestWritable();
             break;
         case LWS_CALLBACK_CLOSED:
-            ILOG("Websocket client connection closed");
-            webSocketWritable = WebSocketState::UNWRITEABLE;
+            GetInstance().RemoveClient(wsi);
             break;
         default:
             break;
@@ -108,11 +102,13 @@ void WebSocketServer::StartWebsocketListening()
         ELOG("WebSocketServer::StartWebsocketListening context memory allocation failed");
         return;
     }
+    serviceContext = context;
     while (!interrupted) {
         if (lws_service(context, WEBSOCKET_SERVER_TIMEOUT)) {
             interrupted = true;
         }
     }
+    serviceContext = nullptr;
     lws_context_destroy(context);
 }
 
@@ -126,13 +122,168 @@ void WebSocketServer::Run()
     serverThread->detach();
 }
 
-size_t WebSocketServer::WriteData(unsigned char* data, size_t length)
+void WebSocketServer::SetLastFrame(SharedFramePtr frame)
 {
-    while (webSocketWritable != WebSocketState::WRITEABLE) {
-        this_thread::sleep_for(chrono::milliseconds(1));
+    {
+        std::lock_guard<std::mutex> guard(lastFrameMutex);
+        lastFrame.swap(frame);
     }
-    if (webSocket != nullptr && webSocketWritable == WebSocketState::WRITEABLE) {
-        return lws_write(webSocket, data, length, LWS_WRITE_BINARY);
+    // frame now holds the replaced frame, it goes back to the pool outside the lock.
+}
+
+SharedFramePtr WebSocketServer::GetLastFrame() const
+{
+    std::lock_guard<std::mutex> guard(lastFrameMutex);
+    return lastFrame;
+}
+
+void WebSocketServer::SetKeyFrameRequestCallback(std::function<void()> callback)
+{
+    std::lock_guard<std::mutex> guard(keyFrameRequestMutex);
+    keyFrameRequestCallback = std::move(callback);
+}
+
+void WebSocketServer::RequestKeyFrame()
+{
+    std::lock_guard<std::mutex> guard(keyFrameRequestMutex);
+    if (keyFrameRequestCallback) {
+        keyFrameRequestCallback();
+    }
+}
+
+void WebSocketServer::ReleaseFrames()
+{
+    SetLastFrame(nullptr);
+    std::lock_guard<std::mutex> guard(clientsMutex);
+    for (auto& [wsi, client] : clients) {
+        client.pendingFrame.reset();
+    }
+}
+
+size_t WebSocketServer::WriteData(SharedFramePtr frame, bool isKeyFrame)
+{
+    if (frame == nullptr) {
+        return 0;
+    }
+    // Never blocks: without clients the frame is only dropped, a client that connects later gets the last key frame.
+    PerfStats::Clock::time_point queueTime = PerfStats::Clock::now();
+    bool isKeyFrameRequested = false;
+    uint32_t droppedCount = 0;
+    {
+        std::lock_guard<std::mutex> guard(clientsMutex);
+        if (clients.empty()) {
+            return 0;
+        }
+        for (auto& [wsi, client] : clients) {
+            if (isKeyFrame) {
+                client.isWaitingKeyFrame = false;
+            } else if (client.isWaitingKeyFrame) {
+                client.droppedCount++;
+                droppedCount++;
+                continue;
+            } else if (client.pendingFrame != nullptr) {
+                // The pending frame is still needed and this one would be lost, the client waits for a key frame.
+                client.isWaitingKeyFrame = true;
+                client.droppedCount++;
+                droppedCount++;
+                keyFrameRequestCount++;
+                isKeyFrameRequested = true;
+                continue;
+            }
+            if (client.pendingFrame != nullptr) {
+                client.droppedCount++;
+                droppedCount++;
+            }
+            client.pendingFrame = frame;
+            client.queueTime = queueTime;
+        }
+    }
+    backlogDroppedCount += droppedCount;
+    // The skipped frame may have been the last change, the current frame is sent again as a key frame.
+    if (isKeyFrameRequested) {
+        RequestKeyFrame();
+    }
+    lws_context* context = serviceContext;
+    if (context != nullptr) {
+        lws_cancel_service(context);
+    }
+    return frame->GetSize();
+}
+
+void WebSocketServer::AddClient(lws* wsi)
+{
+    std::lock_guard<std::mutex> guard(clientsMutex);
+    Client& client = clients[wsi];
+    client.pendingFrame = GetLastFrame();
+    client.queueTime = PerfStats::Clock::now();
+    // The retained frame may be older than the region or delta frames that follow, they are held back until the
+    // key frame requested for the new connection.
+    client.isWaitingKeyFrame = true;
+    ILOG("Websocket client connect, %zu clients", clients.size());
+}
+
+void WebSocketServer::RemoveClient(lws* wsi)
+{
+    std::lock_guard<std::mutex> guard(clientsMutex);
+    auto iter = clients.find(wsi);
+    if (iter == clients.end()) {
+        return;
+    }
+    ILOG("Websocket client connection closed, sent frames: %llu dropped frames: %llu",
+         static_cast<unsigned long long>(iter->second.sentCount),
+         static_cast<unsigned long long>(iter->second.droppedCount));
+    clients.erase(iter);
+    if (clients.empty()) {
+        webSocketWritable = WebSocketState::UNWRITEABLE;
+    }
+}
+
+void WebSocketServer::SendPendingFrame(lws* wsi)
+{
+    // A choked client keeps its pending frame, newer frames keep replacing it until the socket drained.
+    if (lws_send_pipe_choked(wsi)) {
+        lws_callback_on_writable(wsi);
+        return;
+    }
+    SharedFramePtr frame;
+    PerfStats::Clock::time_point queueTime;
+    {
+        std::lock_guard<std::mutex> guard(clientsMutex);
+        auto iter = clients.find(wsi);
+        if (iter == clients.end() || iter->second.pendingFrame == nullptr) {
+            return;
+        }
+        frame.swap(iter->second.pendingFrame);
+        queueTime = iter->second.queueTime;
+        iter->second.sentCount++;
+    }
+    // The frame is shared by all clients, lws_write only writes its framing into the LWS_PRE headroom and all
+    // writes happen on the service thread, one after the other.
+    if (lws_write(wsi, frame->GetWriteData(), frame->GetSize(), LWS_WRITE_BINARY) < 0) {
+        ELOG("WebSocketServer::SendPendingFrame lws_write failed");
+        return;
+    }
+    PerfStats::Clock::time_point sentTime = PerfStats::GetInstance().Record(PerfStats::Stage::ACK, queueTime);
+    int64_t queueUs = std::chrono::duration_cast<std::chrono::microseconds>(sentTime - queueTime).count();
+    int64_t maxQueueUs = backlogQueueUs;
+    while (queueUs > maxQueueUs && !backlogQueueUs.compare_exchange_weak(maxQueueUs, queueUs)) {
+    }
+}
+
+WebSocketServer::Backlog WebSocketServer::TakeBacklog()
+{
+    Backlog backlog;
+    backlog.droppedCount = backlogDroppedCount.exchange(0);
+    backlog.maxQueueUs = backlogQueueUs.exchange(0);
+    return backlog;
+}
+
+void WebSocketServer::RequestWritable()
+{
+    std::lock_guard<std::mutex> guard(clientsMutex);
+    for (auto& [wsi, client] : clients) {
+        if (client.pendingFrame != nullptr) {
+            lws_callback_on_writable(wsi);
+        }
     }
-    return 0;
 }
@@ -16,11 +16,18 @@
 #ifndef WEBSOCKETSERVER_H
 #define WEBSOCKETSERVER_H
 
+#include <atomic>
 #include <thread>
 #include <csignal>
+#include <functional>
+#include <map>
 #include <mutex>
 #include "libwebsockets.h"
 
+#include "FrameBufferPool.h"
+#include "PerfStats.h"
+#include "SharedFrame.h"
+
 class WebSocketServer {
 public:
     WebSocketServer& operator=(const WebSocketServer&) = delete;
@@ -30,24 +37,67 @@ public:
     static int ProtocolCallback(struct lws* wsi, enum lws_callback_reasons reason, void* user, void* in, size_t len);
     void StartWebsocketListening();
     void Run();
-    size_t WriteData(unsigned char* data, size_t length);
+    // Queues the frame for every connected client and wakes the service thread, which sends it. Never blocks,
+    // returns 0 if no client is connected. Only the service thread calls lws_write. Frames that are not key
+    // frames (region and delta frames) only apply on top of the previous frame and are never skipped.
+    size_t WriteData(SharedFramePtr frame, bool isKeyFrame);
     enum class WebSocketState { INIT = -1, UNWRITEABLE = 0, WRITEABLE = 1 };
-    static WebSocketState webSocketWritable;
-    static uint8_t* firstImageBuffer;
-    static uint64_t firstImagebufferSize;
+    static std::atomic<WebSocketState> webSocketWritable; // WRITEABLE while at least one client is connected
+    // The last full frame, sent to every new client right after it connected.
+    void SetLastFrame(SharedFramePtr frame);
+    SharedFramePtr GetLastFrame() const;
+    // Drops the last frame and the frames not sent yet, they have to go back to FrameBufferPool before it is
+    // destroyed at exit.
+    void ReleaseFrames();
+    static std::atomic<uint32_t> connectionCount; // bumped for every new client, new clients need a full frame
+    // Called after connectionCount or keyFrameRequestCount changed, on the service thread or in WriteData, so the
+    // current frame is sent again as a key frame even if nothing is rendered. nullptr removes the callback.
+    void SetKeyFrameRequestCallback(std::function<void()> callback);
+    static std::atomic<uint32_t> keyFrameRequestCount; // bumped when a client had to skip a region or delta frame
+    // WriteData never blocks, a client that does not keep up only shows in the backlog: the frames skipped in the
+    // client queues and the longest time a sent frame waited in its queue, both since the last call.
+    struct Backlog {
+        uint32_t droppedCount = 0;
+        int64_t maxQueueUs = 0;
+    };
+    Backlog TakeBacklog();
     std::mutex mutex;
 
 private:
+    // Every client has a queue of one frame: a frame it did not take yet is replaced by a newer key frame, so a
+    // slow client only skips frames and never holds back the other clients or the sending thread. A client that
+    // would have to skip a region or delta frame gets no more of them until the next key frame.
+    struct Client {
+        SharedFramePtr pendingFrame;
+        PerfStats::Clock::time_point queueTime;
+        bool isWaitingKeyFrame = false;
+        uint64_t sentCount = 0;
+        uint64_t droppedCount = 0;
+    };
+
     WebSocketServer();
     virtual ~WebSocketServer();
     static void SignalHandler(int sig);
+    void AddClient(lws* wsi);
+    void RemoveClient(lws* wsi);
+    void SendPendingFrame(lws* wsi);
+    void RequestWritable();
+    void RequestKeyFrame();
     std::unique_ptr<std::thread> serverThread;
     int serverPort;
     const char* serverHostname = "127.0.0.1";
     int websocketMaxConn = 1024;
-    static lws* webSocket;
+    std::map<lws*, Client> clients; // guarded by clientsMutex, entries are added and removed on the service thread
+    std::mutex clientsMutex;
+    std::atomic<lws_context*> serviceContext;
+    std::atomic<uint32_t> backlogDroppedCount {0};
+    std::atomic<int64_t> backlogQueueUs {0};
     static bool interrupted;
     static int8_t* receivedMessage;
+    SharedFramePtr lastFrame;
+    mutable std::mutex lastFrameMutex; // only guards the pointer swap
+    std::function<void()> keyFrameRequestCallback;
+    std::mutex keyFrameRequestMutex;
     static const int MAX_PAYLOAD_SIZE = 6400000;
     static const int WEBSOCKET_SERVER_TIMEOUT = 1000;
     struct lws_protocols protocols[2];
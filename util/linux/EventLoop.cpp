@@ -0,0 +1,115 @@
+/*
+ * Copyright (c) 2023 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "EventLoop.h"
+
+#include <cerrno>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <thread>
+#include <unistd.h>
+
+#include "PreviewerEngineLog.h"
+
+namespace {
+constexpr int MAX_EVENTS = 8;
+constexpr int64_t MS_PER_SECOND = 1000;
+constexpr int64_t NS_PER_MS = 1000000;
+
+bool AddHandle(int epollHandle, int handle, uint32_t events)
+{
+    struct epoll_event event = {};
+    event.events = events;
+    event.data.fd = handle;
+    return epoll_ctl(epollHandle, EPOLL_CTL_ADD, handle, &event) == 0;
+}
+}
+
+EventLoop::EventLoop() : epollHandle(-1), timerHandle(-1), wakeupHandle(-1)
+{
+    epollHandle = epoll_create1(EPOLL_CLOEXEC);
+    timerHandle = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    wakeupHandle = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (epollHandle < 0 || timerHandle < 0 || wakeupHandle < 0 || !AddHandle(epollHandle, timerHandle, EPOLLIN) ||
+        !AddHandle(epollHandle, wakeupHandle, EPOLLIN)) {
+        ELOG("EventLoop::EventLoop epoll setup failed: %d, Wait sleeps instead", errno);
+        if (epollHandle >= 0) {
+            close(epollHandle);
+            epollHandle = -1;
+        }
+    }
+    Register();
+}
+
+EventLoop::~EventLoop()
+{
+    Unregister();
+    for (int handle : {epollHandle, timerHandle, wakeupHandle}) {
+        if (handle >= 0) {
+            close(handle);
+        }
+    }
+}
+
+void EventLoop::WatchSocket(const LocalSocket& socket)
+{
+    if (epollHandle < 0 || socket.socketHandle < 0) {
+        return;
+    }
+    if (!AddHandle(epollHandle, socket.socketHandle, EPOLLIN | EPOLLRDHUP)) {
+        ELOG("EventLoop::WatchSocket epoll_ctl failed: %d", errno);
+    }
+}
+
+void EventLoop::Wait(std::chrono::milliseconds timeout)
+{
+    if (timeout.count() <= 0) {
+        return;
+    }
+    if (epollHandle < 0) {
+        std::this_thread::sleep_for(std::min(timeout, std::chrono::milliseconds(1)));
+        return;
+    }
+    // Setting the timer also clears an expiration left over from the last Wait.
+    struct itimerspec timerSpec = {};
+    timerSpec.it_value.tv_sec = static_cast<time_t>(timeout.count() / MS_PER_SECOND);
+    timerSpec.it_value.tv_nsec = static_cast<long>(timeout.count() % MS_PER_SECOND * NS_PER_MS);
+    timerfd_settime(timerHandle, 0, &timerSpec, nullptr);
+    struct epoll_event events[MAX_EVENTS];
+    int count = epoll_wait(epollHandle, events, MAX_EVENTS, -1);
+    for (int i = 0; i < count; i++) {
+        int handle = events[i].data.fd;
+        if (handle == timerHandle || handle == wakeupHandle) {
+            uint64_t value = 0;
+            (void)read(handle, &value, sizeof(value));
+            continue;
+        }
+        // A closed socket stays readable forever, it would turn the loop into a busy loop.
+        if (events[i].events & (EPOLLRDHUP | EPOLLHUP | EPOLLERR)) {
+            epoll_ctl(epollHandle, EPOLL_CTL_DEL, handle, nullptr);
+            ILOG("EventLoop::Wait socket closed, it is no longer watched");
+        }
+    }
+}
+
+void EventLoop::Wakeup()
+{
+    if (wakeupHandle < 0) {
+        return;
+    }
+    uint64_t value = 1;
+    (void)write(wakeupHandle, &value, sizeof(value));
+}
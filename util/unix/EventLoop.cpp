@@ -0,0 +1,102 @@
+/*
+ * Copyright (c) 2023 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "EventLoop.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <thread>
+#include <unistd.h>
+
+#include "PreviewerEngineLog.h"
+
+EventLoop::EventLoop() : wakeupPipe {-1, -1}
+{
+    if (pipe(wakeupPipe) != 0) {
+        ELOG("EventLoop::EventLoop pipe failed: %d, Wait sleeps instead", errno);
+        wakeupPipe[0] = -1;
+        wakeupPipe[1] = -1;
+    } else {
+        for (int handle : wakeupPipe) {
+            fcntl(handle, F_SETFL, fcntl(handle, F_GETFL) | O_NONBLOCK);
+            fcntl(handle, F_SETFD, FD_CLOEXEC);
+        }
+    }
+    Register();
+}
+
+EventLoop::~EventLoop()
+{
+    Unregister();
+    for (int handle : wakeupPipe) {
+        if (handle >= 0) {
+            close(handle);
+        }
+    }
+}
+
+void EventLoop::WatchSocket(const LocalSocket& socket)
+{
+    if (socket.socketHandle >= 0) {
+        socketHandles.push_back(socket.socketHandle);
+    }
+}
+
+void EventLoop::Wait(std::chrono::milliseconds timeout)
+{
+    if (timeout.count() <= 0) {
+        return;
+    }
+    if (wakeupPipe[0] < 0) {
+        std::this_thread::sleep_for(std::min(timeout, std::chrono::milliseconds(1)));
+        return;
+    }
+    std::vector<struct pollfd> handles(socketHandles.size() + 1);
+    handles[0] = {wakeupPipe[0], POLLIN, 0};
+    for (size_t i = 0; i < socketHandles.size(); i++) {
+        handles[i + 1] = {socketHandles[i], POLLIN, 0};
+    }
+    int timeoutMs = static_cast<int>(std::min<int64_t>(timeout.count(), INT_MAX));
+    if (poll(handles.data(), handles.size(), timeoutMs) <= 0) {
+        return;
+    }
+    if (handles[0].revents != 0) {
+        char buffer[64]; // 64: drains many wakeups per read
+        while (read(wakeupPipe[0], buffer, sizeof(buffer)) > 0) {}
+    }
+    for (size_t i = 1; i < handles.size(); i++) {
+        // A closed socket stays readable forever with nothing to read, it would turn the loop into a busy loop.
+        int pending = 0;
+        bool isClosed = (handles[i].revents & (POLLHUP | POLLERR | POLLNVAL)) != 0 ||
+            ((handles[i].revents & POLLIN) != 0 && ioctl(handles[i].fd, FIONREAD, &pending) == 0 && pending == 0);
+        if (isClosed) {
+            socketHandles.erase(std::find(socketHandles.begin(), socketHandles.end(), handles[i].fd));
+            ILOG("EventLoop::Wait socket closed, it is no longer watched");
+        }
+    }
+}
+
+void EventLoop::Wakeup()
+{
+    if (wakeupPipe[1] < 0) {
+        return;
+    }
+    char value = 1;
+    (void)write(wakeupPipe[1], &value, sizeof(value)); // a full pipe already wakes the loop
+}
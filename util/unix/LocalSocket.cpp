@@ -15,9 +15,11 @@
 
 #include "LocalSocket.h"
 
+#include <cerrno>
 #include <sys/ioctl.h>
 #include <sys/socket.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 #include <sys/un.h>
 
 #include "PreviewerEngineLog.h"
@@ -100,21 +102,69 @@ int64_t LocalSocket::ReadData(char* data, size_t length) const
 
 size_t LocalSocket::WriteData(const void* data, size_t length) const
 {
-    if (length > UINT32_MAX) {
-        ELOG("LocalSocket::WriteData length must < %d", UINT32_MAX);
+    Segment segment = {data, length};
+    return WriteSegments(&segment, 1);
+}
+
+size_t LocalSocket::WriteSegments(const Segment* segments, size_t count) const
+{
+    if (segments == nullptr || count > maxSegmentCount) {
+        ELOG("LocalSocket::WriteSegments at most %zu segments are supported", maxSegmentCount);
         return 0;
     }
-    string str((const char*)data);
-    ssize_t writeSize = send(socketHandle, str.c_str(), length, 0);
-    if (writeSize == 0) {
-        ELOG("LocalSocket::WriteData Server is shut down");
+    struct iovec vectors[maxSegmentCount];
+    size_t vectorCount = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (segments[i].data != nullptr && segments[i].length > 0) {
+            vectors[vectorCount].iov_base = const_cast<void*>(segments[i].data);
+            vectors[vectorCount].iov_len = segments[i].length;
+            vectorCount++;
+        }
     }
-
-    if (writeSize < 0) {
-        ELOG("LocalSocket::WriteData ReadFile failed");
+    size_t written = 0;
+    size_t index = 0;
+    // A partial write is continued below, no other thread may write in between.
+    std::lock_guard<std::mutex> guard(writeMutex);
+    while (index < vectorCount) {
+        struct msghdr message = {};
+        message.msg_iov = vectors + index;
+        message.msg_iovlen = vectorCount - index;
+        ssize_t writeSize = sendmsg(socketHandle, &message, 0);
+        if (writeSize < 0 && errno == EINTR) {
+            continue;
+        }
+        if (writeSize == 0) {
+            ELOG("LocalSocket::WriteSegments Server is shut down");
+            break;
+        }
+        if (writeSize < 0) {
+            ELOG("LocalSocket::WriteSegments sendmsg failed");
+            break;
+        }
+        written += static_cast<size_t>(writeSize);
+        // Skip the segments that were sent completely, the next write continues inside the first remaining one.
+        size_t remaining = static_cast<size_t>(writeSize);
+        while (index < vectorCount && remaining >= vectors[index].iov_len) {
+            remaining -= vectors[index].iov_len;
+            index++;
+        }
+        if (index < vectorCount) {
+            vectors[index].iov_base = static_cast<char*>(vectors[index].iov_base) + remaining;
+            vectors[index].iov_len -= remaining;
+        }
     }
+    return written;
+}
 
-    return writeSize;
+size_t LocalSocket::WriteMessage(const char* data, size_t length) const
+{
+    Segment segments[] = {{data, length}, {"", 1}}; // 1: the NUL terminator of the empty literal
+    return WriteSegments(segments, sizeof(segments) / sizeof(segments[0]));
+}
+
+size_t LocalSocket::WriteMessage(const string& message) const
+{
+    return WriteMessage(message.data(), message.size());
 }
 
 const LocalSocket& LocalSocket::operator>>(string& data) const
@@ -126,8 +176,8 @@ const LocalSocket& LocalSocket::operator>>(string& data) const
     return *this;
 }
 
-const LocalSocket& LocalSocket::operator<<(const string data) const
+const LocalSocket& LocalSocket::operator<<(const string& data) const
 {
-    WriteData(data.c_str(), data.length() + 1);
+    WriteMessage(data);
     return *this;
 }
\ No newline at end of file
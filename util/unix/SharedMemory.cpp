@@ -0,0 +1,201 @@
+/*
+ * Copyright (c) 2023 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "SharedMemory.h"
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <time.h>
+#include <unistd.h>
+
+#include "PreviewerEngineLog.h"
+
+SharedMemory::SharedMemory()
+    : data(nullptr), size(0), fileHandle(-1), doorbell(SEM_FAILED), isOwner(false)
+{
+}
+
+SharedMemory::~SharedMemory()
+{
+    Destroy();
+}
+
+bool SharedMemory::Create(const std::string& name, size_t length)
+{
+    Destroy();
+    memoryName = "/" + name;
+    doorbellName = "/" + name + ".bell";
+    const mode_t accessMode = 0600; // only the user running the previewer may map the frames
+    // Objects left behind by a previewer that crashed are replaced, consumers still mapping them keep them.
+    shm_unlink(memoryName.c_str());
+    sem_unlink(doorbellName.c_str());
+    fileHandle = shm_open(memoryName.c_str(), O_CREAT | O_EXCL | O_RDWR, accessMode);
+    if (fileHandle < 0) {
+        ELOG("SharedMemory::Create shm_open %s failed: %s", memoryName.c_str(), strerror(errno));
+        return false;
+    }
+    if (ftruncate(fileHandle, static_cast<off_t>(length)) != 0) {
+        ELOG("SharedMemory::Create ftruncate %zu failed: %s", length, strerror(errno));
+        Destroy();
+        return false;
+    }
+    void* address = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fileHandle, 0);
+    if (address == MAP_FAILED) {
+        ELOG("SharedMemory::Create mmap %zu failed: %s", length, strerror(errno));
+        Destroy();
+        return false;
+    }
+    data = static_cast<uint8_t*>(address);
+    size = length;
+    doorbell = sem_open(doorbellName.c_str(), O_CREAT | O_EXCL, accessMode, 0);
+    if (doorbell == SEM_FAILED) {
+        ELOG("SharedMemory::Create sem_open %s failed: %s", doorbellName.c_str(), strerror(errno));
+        Destroy();
+        return false;
+    }
+    isOwner = true;
+    return true;
+}
+
+bool SharedMemory::Open(const std::string& name, size_t length)
+{
+    Destroy();
+    memoryName = "/" + name;
+    doorbellName = "/" + name + ".bell";
+    fileHandle = shm_open(memoryName.c_str(), O_RDWR, 0);
+    if (fileHandle < 0) {
+        ELOG("SharedMemory::Open shm_open %s failed: %s", memoryName.c_str(), strerror(errno));
+        return false;
+    }
+    struct stat status;
+    if (fstat(fileHandle, &status) != 0 || static_cast<size_t>(status.st_size) < length) {
+        ELOG("SharedMemory::Open %s is smaller than %zu bytes", memoryName.c_str(), length);
+        Destroy();
+        return false;
+    }
+    void* address = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fileHandle, 0);
+    if (address == MAP_FAILED) {
+        ELOG("SharedMemory::Open mmap %zu failed: %s", length, strerror(errno));
+        Destroy();
+        return false;
+    }
+    data = static_cast<uint8_t*>(address);
+    size = length;
+    doorbell = sem_open(doorbellName.c_str(), 0);
+    if (doorbell == SEM_FAILED) {
+        ELOG("SharedMemory::Open sem_open %s failed: %s", doorbellName.c_str(), strerror(errno));
+        Destroy();
+        return false;
+    }
+    return true;
+}
+
+void SharedMemory::Destroy()
+{
+    if (doorbell != SEM_FAILED) {
+        sem_close(doorbell);
+        if (isOwner) {
+            sem_unlink(doorbellName.c_str());
+        }
+        doorbell = SEM_FAILED;
+    }
+    if (data != nullptr) {
+        munmap(data, size);
+        data = nullptr;
+        size = 0;
+    }
+    if (fileHandle >= 0) {
+        close(fileHandle);
+        if (isOwner) {
+            shm_unlink(memoryName.c_str());
+        }
+        fileHandle = -1;
+    }
+    isOwner = false;
+}
+
+uint8_t* SharedMemory::GetData() const
+{
+    return data;
+}
+
+size_t SharedMemory::GetSize() const
+{
+    return size;
+}
+
+bool SharedMemory::Commit(size_t offset, size_t length)
+{
+    if (data == nullptr || offset > size || length > size - offset) {
+        return false;
+    }
+#ifdef __linux__
+    // /dev/shm is a tmpfs with a size limit, a write to a sparse page beyond it raises SIGBUS. Reserving the
+    // pages turns that into ENOSPC here.
+    int result = posix_fallocate(fileHandle, static_cast<off_t>(offset), static_cast<off_t>(length));
+    if (result != 0) {
+        ELOG("SharedMemory::Commit %zu bytes at %zu failed: %s", length, offset, strerror(result));
+        return false;
+    }
+#endif // __linux__
+    return true;
+}
+
+void SharedMemory::Notify() const
+{
+    if (doorbell != SEM_FAILED) {
+        sem_post(doorbell);
+    }
+}
+
+bool SharedMemory::Wait(std::chrono::milliseconds timeout) const
+{
+    if (doorbell == SEM_FAILED) {
+        return false;
+    }
+#ifdef __APPLE__
+    // macOS has no sem_timedwait, the doorbell is polled instead.
+    const std::chrono::milliseconds pollPeriod(1);
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    while (sem_trywait(doorbell) != 0) {
+        if ((errno != EAGAIN && errno != EINTR) || std::chrono::steady_clock::now() >= deadline) {
+            return false;
+        }
+        std::this_thread::sleep_for(pollPeriod);
+    }
+    return true;
+#else
+    const long nsPerSecond = 1000000000;
+    auto timeoutNs = std::chrono::duration_cast<std::chrono::nanoseconds>(timeout).count();
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += static_cast<time_t>(timeoutNs / nsPerSecond);
+    deadline.tv_nsec += static_cast<long>(timeoutNs % nsPerSecond);
+    if (deadline.tv_nsec >= nsPerSecond) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= nsPerSecond;
+    }
+    while (sem_timedwait(doorbell, &deadline) != 0) {
+        if (errno != EINTR) {
+            return false;
+        }
+    }
+    return true;
+#endif // __APPLE__
+}
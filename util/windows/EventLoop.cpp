@@ -0,0 +1,122 @@
+/*
+ * Copyright (c) 2023 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "EventLoop.h"
+
+#include <algorithm>
+
+#include "PreviewerEngineLog.h"
+
+EventLoop::EventLoop()
+    : wakeupEvent(nullptr), readEvent(nullptr), pipeHandle(nullptr), readOverlapped {}, isReadPending(false)
+{
+    wakeupEvent = CreateEventA(nullptr, FALSE, FALSE, nullptr); // auto reset, a wait consumes the wakeup
+    readEvent = CreateEventA(nullptr, TRUE, FALSE, nullptr);    // reset by ReadFile when a read starts
+    if (wakeupEvent == nullptr || readEvent == nullptr) {
+        ELOG("EventLoop::EventLoop CreateEventA failed: %d, Wait sleeps instead", GetLastError());
+    }
+    Register();
+}
+
+EventLoop::~EventLoop()
+{
+    Unregister();
+    // The pending read writes into readOverlapped, it has to be finished before the memory goes away.
+    if (isReadPending && CancelIoEx(pipeHandle, &readOverlapped)) {
+        DWORD transferred = 0;
+        GetOverlappedResult(pipeHandle, &readOverlapped, &transferred, TRUE);
+    }
+    for (HANDLE event : {wakeupEvent, readEvent}) {
+        if (event != nullptr) {
+            CloseHandle(event);
+        }
+    }
+}
+
+void EventLoop::WatchSocket(const LocalSocket& socket)
+{
+    if (socket.pipeHandle != nullptr && socket.pipeHandle != INVALID_HANDLE_VALUE) {
+        pipeHandle = socket.pipeHandle;
+    }
+}
+
+bool EventLoop::IsPipeReadable()
+{
+    if (isReadPending) {
+        return false;
+    }
+    // A zero byte read on a named pipe completes once data arrived without taking any of it, the socket reads
+    // the data itself.
+    static char zeroReadBuffer;
+    readOverlapped = {};
+    readOverlapped.hEvent = readEvent;
+    if (ReadFile(pipeHandle, &zeroReadBuffer, 0, nullptr, &readOverlapped)) {
+        return true;
+    }
+    if (GetLastError() != ERROR_IO_PENDING) {
+        ILOG("EventLoop::IsPipeReadable pipe is no longer watched: %d", GetLastError());
+        pipeHandle = nullptr;
+        return false;
+    }
+    isReadPending = true;
+    return false;
+}
+
+void EventLoop::FinishPipeRead()
+{
+    DWORD transferred = 0;
+    if (GetOverlappedResult(pipeHandle, &readOverlapped, &transferred, FALSE)) {
+        isReadPending = false;
+        return;
+    }
+    if (GetLastError() == ERROR_IO_INCOMPLETE) {
+        return; // no data yet, the read stays pending for the next Wait
+    }
+    ILOG("EventLoop::FinishPipeRead pipe is no longer watched: %d", GetLastError());
+    isReadPending = false;
+    pipeHandle = nullptr;
+}
+
+void EventLoop::Wait(std::chrono::milliseconds timeout)
+{
+    int64_t timeoutMs = timeout.count();
+    if (timeoutMs <= 0) {
+        return;
+    }
+    timeoutMs = std::min<int64_t>(timeoutMs, INFINITE - 1);
+    if (wakeupEvent == nullptr || readEvent == nullptr) {
+        if (pipeHandle != nullptr) {
+            timeoutMs = std::min<int64_t>(timeoutMs, pipePollInterval);
+        }
+        Sleep(static_cast<DWORD>(timeoutMs));
+        return;
+    }
+    if (pipeHandle != nullptr && IsPipeReadable()) {
+        return;
+    }
+    HANDLE events[] = {wakeupEvent, readEvent};
+    DWORD eventCount = pipeHandle != nullptr ? 2 : 1; // 2: the pipe is watched as well
+    WaitForMultipleObjects(eventCount, events, FALSE, static_cast<DWORD>(timeoutMs));
+    if (isReadPending) {
+        FinishPipeRead();
+    }
+}
+
+void EventLoop::Wakeup()
+{
+    if (wakeupEvent != nullptr) {
+        SetEvent(wakeupEvent);
+    }
+}
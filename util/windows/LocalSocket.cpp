@@ -15,9 +15,44 @@
 
 #include "LocalSocket.h"
 
+#include <algorithm>
+
 #include "PreviewerEngineLog.h"
 
 using namespace std;
+
+namespace {
+// The pipe is opened for overlapped I/O, so every read and write needs an OVERLAPPED with its own event.
+class OverlappedIo {
+public:
+    OverlappedIo() : overlapped {}
+    {
+        overlapped.hEvent = CreateEventA(nullptr, TRUE, FALSE, nullptr);
+    }
+
+    ~OverlappedIo()
+    {
+        if (overlapped.hEvent != nullptr) {
+            CloseHandle(overlapped.hEvent);
+        }
+    }
+
+    OverlappedIo(const OverlappedIo&) = delete;
+    OverlappedIo& operator=(const OverlappedIo&) = delete;
+
+    // Waits for the operation ReadFile or WriteFile started, isStarted is what they returned.
+    bool Complete(HANDLE handle, BOOL isStarted, DWORD& transferred)
+    {
+        if (!isStarted && GetLastError() != ERROR_IO_PENDING) {
+            return false;
+        }
+        return GetOverlappedResult(handle, &overlapped, &transferred, TRUE) != FALSE;
+    }
+
+    OVERLAPPED overlapped;
+};
+}
+
 LocalSocket::LocalSocket() : pipeHandle(nullptr) {}
 
 LocalSocket::~LocalSocket() {}
@@ -27,7 +62,9 @@ bool LocalSocket::ConnectToServer(string name, LocalSocket::OpenMode openMode, T
     wstring tempName = wstring(name.begin(), name.end());
 
     DWORD openModeWin = GetWinOpenMode(openMode);
-    pipeHandle = CreateFileW(tempName.c_str(), openModeWin, 0, nullptr, OPEN_EXISTING, 0, NULL);
+    // Overlapped I/O lets EventLoop wait for data with a pending read while other threads write, a blocking
+    // read on a synchronous handle would hold back every write until data arrived.
+    pipeHandle = CreateFileW(tempName.c_str(), openModeWin, 0, nullptr, OPEN_EXISTING, FILE_FLAG_OVERLAPPED, NULL);
     if (pipeHandle == INVALID_HANDLE_VALUE) {
         ELOG("LocalSocket::ConnectToServer CreateFileW failed: %d", GetLastError());
         return false;
@@ -78,7 +115,10 @@ int64_t LocalSocket::ReadData(char* data, size_t length) const
         return 0;
     }
 
-    if (!ReadFile(pipeHandle, data, static_cast<DWORD>(length), &readSize, NULL)) {
+    // Never ask for more than is available, ReadFile would block until the rest arrived.
+    DWORD readLength = static_cast<DWORD>(std::min<size_t>(length, readSize));
+    OverlappedIo io;
+    if (!io.Complete(pipeHandle, ReadFile(pipeHandle, data, readLength, nullptr, &io.overlapped), readSize)) {
         DWORD error = GetLastError();
         ELOG("LocalSocket::ReadData ReadFile failed: %d", error);
         return 0 - static_cast<int64_t>(error);
@@ -88,23 +128,57 @@ int64_t LocalSocket::ReadData(char* data, size_t length) const
 
 size_t LocalSocket::WriteData(const void* data, size_t length) const
 {
-    if (length > UINT32_MAX) {
-        ELOG("LocalSocket::WriteData length must < %d", UINT32_MAX);
+    Segment segment = {data, length};
+    return WriteSegments(&segment, 1);
+}
+
+size_t LocalSocket::WriteSegments(const Segment* segments, size_t count) const
+{
+    if (segments == nullptr || count > maxSegmentCount) {
+        ELOG("LocalSocket::WriteSegments at most %zu segments are supported", maxSegmentCount);
         return 0;
     }
-
-    DWORD writeSize = 0;
-    if (!WriteFile(pipeHandle, data, static_cast<DWORD>(length), &writeSize, nullptr)) {
-        DWORD error = GetLastError();
-        ELOG("LocalSocket::WriteData WriteFile failed: %d", error);
-        return 0 - static_cast<size_t>(error);
+    // Pipes have no gather write, the segments are written one after the other without copying them.
+    std::lock_guard<std::mutex> guard(writeMutex);
+    OverlappedIo io;
+    size_t written = 0;
+    for (size_t i = 0; i < count; i++) {
+        const char* data = static_cast<const char*>(segments[i].data);
+        size_t remaining = data == nullptr ? 0 : segments[i].length;
+        while (remaining > 0) {
+            DWORD writeSize = 0;
+            DWORD length = static_cast<DWORD>(std::min<size_t>(remaining, MAXDWORD));
+            if (!io.Complete(pipeHandle, WriteFile(pipeHandle, data, length, nullptr, &io.overlapped), writeSize)) {
+                ELOG("LocalSocket::WriteSegments WriteFile failed: %d", GetLastError());
+                return written;
+            }
+            if (writeSize == 0) {
+                ELOG("LocalSocket::WriteSegments Server is shut down");
+                return written;
+            }
+            data += writeSize;
+            remaining -= writeSize;
+            written += writeSize;
+        }
     }
-    return writeSize;
+    return written;
+}
+
+size_t LocalSocket::WriteMessage(const char* data, size_t length) const
+{
+    return WriteMessage(data == nullptr ? string() : string(data, length));
+}
+
+size_t LocalSocket::WriteMessage(const string& message) const
+{
+    // One WriteFile with the terminator, a message mode pipe would split the message otherwise. Commands and
+    // traces are small, copying them is cheaper than a second write.
+    return WriteData(message.c_str(), message.size() + 1);
 }
 
-const LocalSocket& LocalSocket::operator<<(const string data) const
+const LocalSocket& LocalSocket::operator<<(const string& data) const
 {
-    WriteData(data.c_str(), data.length() + 1);
+    WriteMessage(data);
     return *this;
 }
 
@@ -0,0 +1,139 @@
+/*
+ * Copyright (c) 2023 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "SharedMemory.h"
+
+#include "PreviewerEngineLog.h"
+
+SharedMemory::SharedMemory()
+    : data(nullptr), size(0), mappingHandle(nullptr), doorbellHandle(nullptr)
+{
+}
+
+SharedMemory::~SharedMemory()
+{
+    Destroy();
+}
+
+bool SharedMemory::Create(const std::string& name, size_t length)
+{
+    Destroy();
+    const int highShift = 32;
+    uint64_t mappingSize = static_cast<uint64_t>(length);
+    std::string memoryName = "Local\\" + name;
+    // SEC_RESERVE keeps the whole ring out of the commit charge, slots are committed as frames grow.
+    mappingHandle = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE | SEC_RESERVE,
+                                       static_cast<DWORD>(mappingSize >> highShift),
+                                       static_cast<DWORD>(mappingSize), memoryName.c_str());
+    if (mappingHandle == nullptr || GetLastError() == ERROR_ALREADY_EXISTS) {
+        ELOG("SharedMemory::Create CreateFileMapping %s failed: %lu", memoryName.c_str(), GetLastError());
+        Destroy();
+        return false;
+    }
+    data = static_cast<uint8_t*>(MapViewOfFile(mappingHandle, FILE_MAP_ALL_ACCESS, 0, 0, length));
+    if (data == nullptr) {
+        ELOG("SharedMemory::Create MapViewOfFile %zu failed: %lu", length, GetLastError());
+        Destroy();
+        return false;
+    }
+    size = length;
+    // A maximum count of 1 coalesces the notifications of frames the consumer did not wait for yet.
+    std::string doorbellName = memoryName + ".bell";
+    doorbellHandle = CreateSemaphoreA(nullptr, 0, 1, doorbellName.c_str());
+    if (doorbellHandle == nullptr) {
+        ELOG("SharedMemory::Create CreateSemaphore %s failed: %lu", doorbellName.c_str(), GetLastError());
+        Destroy();
+        return false;
+    }
+    return true;
+}
+
+bool SharedMemory::Open(const std::string& name, size_t length)
+{
+    Destroy();
+    std::string memoryName = "Local\\" + name;
+    mappingHandle = OpenFileMappingA(FILE_MAP_ALL_ACCESS, FALSE, memoryName.c_str());
+    if (mappingHandle == nullptr) {
+        ELOG("SharedMemory::Open OpenFileMapping %s failed: %lu", memoryName.c_str(), GetLastError());
+        return false;
+    }
+    data = static_cast<uint8_t*>(MapViewOfFile(mappingHandle, FILE_MAP_ALL_ACCESS, 0, 0, length));
+    if (data == nullptr) {
+        ELOG("SharedMemory::Open MapViewOfFile %zu failed: %lu", length, GetLastError());
+        Destroy();
+        return false;
+    }
+    size = length;
+    std::string doorbellName = memoryName + ".bell";
+    doorbellHandle = OpenSemaphoreA(SYNCHRONIZE | SEMAPHORE_MODIFY_STATE, FALSE, doorbellName.c_str());
+    if (doorbellHandle == nullptr) {
+        ELOG("SharedMemory::Open OpenSemaphore %s failed: %lu", doorbellName.c_str(), GetLastError());
+        Destroy();
+        return false;
+    }
+    return true;
+}
+
+void SharedMemory::Destroy()
+{
+    if (doorbellHandle != nullptr) {
+        CloseHandle(doorbellHandle);
+        doorbellHandle = nullptr;
+    }
+    if (data != nullptr) {
+        UnmapViewOfFile(data);
+        data = nullptr;
+        size = 0;
+    }
+    if (mappingHandle != nullptr) {
+        CloseHandle(mappingHandle);
+        mappingHandle = nullptr;
+    }
+}
+
+uint8_t* SharedMemory::GetData() const
+{
+    return data;
+}
+
+size_t SharedMemory::GetSize() const
+{
+    return size;
+}
+
+bool SharedMemory::Commit(size_t offset, size_t length)
+{
+    if (data == nullptr || offset > size || length > size - offset) {
+        return false;
+    }
+    if (VirtualAlloc(data + offset, length, MEM_COMMIT, PAGE_READWRITE) == nullptr) {
+        ELOG("SharedMemory::Commit %zu bytes failed: %lu", length, GetLastError());
+        return false;
+    }
+    return true;
+}
+
+void SharedMemory::Notify() const
+{
+    if (doorbellHandle != nullptr) {
+        ReleaseSemaphore(doorbellHandle, 1, nullptr);
+    }
+}
+
+bool SharedMemory::Wait(std::chrono::milliseconds timeout) const
+{
+    return doorbellHandle != nullptr &&
+        WaitForSingleObject(doorbellHandle, static_cast<DWORD>(timeout.count())) == WAIT_OBJECT_0;
+}